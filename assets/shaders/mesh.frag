@@ -6,18 +6,19 @@ in vec2 TexCoords;
 in vec3 Normals;
 in vec4 Colors;
 in vec3 CamPos;
+// per instance emissive factor (rgb) and strength (a), unused when a < 0
+flat in vec4 EmissiveOverride;
 
 out vec4 FragColor;
 
-struct Material {
+// std140 layout, keep in sync with MaterialBlock in mesh.hpp
+layout(std140) uniform MaterialBlock {
   vec3 baseColorFactor;
   float metallicFactor;
-  float roughnessFactor;
   vec3 emissiveFactor;
   float emissiveStrength;
-};
-
-uniform Material material;
+  float roughnessFactor;
+} material;
 
 const vec3 ambient = vec3(0.1);
 const vec3 lightColor = vec3(1.0, 0.27, 0.12);
@@ -55,11 +56,17 @@ vec3 getLitResult(vec3 objectColor) {
 }
 
 void main() {
+  bool overrideEmissive = EmissiveOverride.a >= 0.0;
+  vec3 emissiveFactor =
+      overrideEmissive ? EmissiveOverride.rgb : material.emissiveFactor;
+  float emissiveStrength =
+      overrideEmissive ? EmissiveOverride.a : material.emissiveStrength;
+
   vec3 objectColor = material.baseColorFactor * (1.0 - material.metallicFactor) * Colors.rgb;
-  objectColor += material.emissiveFactor * material.emissiveStrength;
+  objectColor += emissiveFactor * emissiveStrength;
 
   // only apply lighting if the object is not emissive
-  if (material.emissiveStrength > 0.0) {
+  if (emissiveStrength > 0.0) {
     FragColor = vec4(objectColor, 1.0);
     return;
   }
@@ -5,21 +5,43 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoords;
 layout(location = 2) in vec3 aNormals;
 layout(location = 3) in vec4 aColors;
+// per instance attributes, only read when instanced is set
+layout(location = 4) in mat4 aInstanceModel;
+layout(location = 8) in vec4 aInstanceEmissive;
 
 out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normals;
 out vec3 CamPos;
 out vec4 Colors;
+flat out vec4 EmissiveOverride;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool instanced;
+// emissive override of non instanced draws
+uniform vec4 emissive;
+// normals are oct encoded in the packed vertex format
+uniform bool packedNormals;
+
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0) {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0,
+                                    n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(n);
+}
 
 void main() {
-  FragPos = vec3(model * vec4(aPos, 1.0));
+  mat4 modelMatrix = instanced ? aInstanceModel : model;
+  EmissiveOverride = instanced ? aInstanceEmissive : emissive;
+
+  FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
   TexCoords = aTexCoords;
-  Normals = mat3(transpose(inverse(model))) * aNormals;
+  vec3 normal = packedNormals ? octDecode(aNormals.xy) : aNormals;
+  Normals = mat3(transpose(inverse(modelMatrix))) * normal;
   CamPos = vec3(inverse(view)[3]);
   Colors = aColors;
   gl_Position = projection * view * vec4(FragPos, 1.0);
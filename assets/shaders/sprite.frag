@@ -1,10 +1,78 @@
 #version 300 es
 precision highp float;
 
+// keep in sync with SPRITE_BATCH_MAX_TEXTURES in sprite-batch.hpp
+#define MAX_TEXTURES 8
+// keep in sync with the SPRITE_BATCH_ texture index flags
+#define NO_TEXTURE 255u
+#define ALPHA_TEXTURE 128u
+#define SDF_TEXTURE 64u
+#define SLOT_MASK 63u
+
 in vec2 uv;
 in vec4 color;
+flat in uint texture_index;
 out vec4 fragColor;
 
-uniform sampler2D albedoTexture;
+uniform sampler2D textures[MAX_TEXTURES];
+
+// sdf text outline width and softness in distance units, and its color
+uniform vec2 text_outline;
+uniform vec4 text_outline_color;
+
+// glsl es 3.00 only allows constant indices into sampler arrays
+vec4 sampleTexture(uint index, vec2 uv) {
+  switch (index) {
+  case 0u:
+    return texture(textures[0], uv);
+  case 1u:
+    return texture(textures[1], uv);
+  case 2u:
+    return texture(textures[2], uv);
+  case 3u:
+    return texture(textures[3], uv);
+  case 4u:
+    return texture(textures[4], uv);
+  case 5u:
+    return texture(textures[5], uv);
+  case 6u:
+    return texture(textures[6], uv);
+  case 7u:
+    return texture(textures[7], uv);
+  default:
+    // untextured quads (DrawRect) only use the vertex color
+    return vec4(1.0);
+  }
+}
+
+// distance fields store 0.5 on the outline and grow towards the inside
+vec4 sampleDistanceField(uint index, vec2 uv) {
+  float distance = sampleTexture(index, uv).r;
+  // screen space antialiasing, stays one pixel wide at any scale
+  float width = fwidth(distance);
+  float fill = smoothstep(0.5 - width, 0.5 + width, distance);
+
+  float outer = 0.5 - text_outline.x;
+  float shape =
+      smoothstep(outer - width - text_outline.y, outer + width, distance);
+
+  // without an outline the edge keeps the text color instead of fading to it
+  vec4 result =
+      text_outline.x > 0.0 ? mix(text_outline_color, color, fill) : color;
+  result.a *= shape;
+  return result;
+}
 
-void main(void) { fragColor = texture(albedoTexture, uv) * color; }
+void main(void) {
+  if (texture_index == NO_TEXTURE) {
+    fragColor = sampleTexture(texture_index, uv) * color;
+  } else if ((texture_index & SDF_TEXTURE) != 0u) {
+    fragColor = sampleDistanceField(texture_index & SLOT_MASK, uv);
+  } else if ((texture_index & ALPHA_TEXTURE) != 0u) {
+    // single channel glyph pages, coverage goes to every channel
+    float coverage = sampleTexture(texture_index & SLOT_MASK, uv).r;
+    fragColor = vec4(coverage) * color;
+  } else {
+    fragColor = sampleTexture(texture_index, uv) * color;
+  }
+}
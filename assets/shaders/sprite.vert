@@ -5,6 +5,7 @@ precision highp float;
 layout(location = 0) in vec2 in_position;
 layout(location = 1) in vec2 in_uv;
 layout(location = 2) in vec4 in_color;
+layout(location = 3) in uint in_texture_index;
 
 uniform mat4 projection; // Projection matrix
 uniform mat4 view;       // View matrix
@@ -12,6 +13,7 @@ uniform mat4 view;       // View matrix
 // output variables
 out vec2 uv;
 out vec4 color;
+flat out uint texture_index;
 
 void main(void) {
   // Calculate the final vertex position
@@ -23,4 +25,5 @@ void main(void) {
   // pass through uv and color
   uv = in_uv;
   color = in_color;
+  texture_index = in_texture_index;
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include <benchmark/benchmark.h>
+#include <render-stats.hpp>
+
+// size of the offscreen framebuffer and the sprite batch projection
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+
+// exit code when nothing failed but benchmarks were skipped for lack of a GL
+// context, ctest reports the run as skipped instead of passed
+#define BENCH_EXIT_NO_GL 77
+
+// true when the headless GL context is current
+bool BenchHasGL();
+
+// skips a benchmark that needs GL when there is no context, returns false if
+// it was skipped
+bool BenchRequireGL(benchmark::State &state);
+
+// stops the benchmark with an error, the bench exits non-zero once every
+// benchmark ran
+void BenchFail(benchmark::State &state, const char *message);
+
+// reports the GL work of the last frame (the last RenderStats::EndFrame) as
+// counters, and fails the benchmark when it took more draw calls than the
+// batching should need
+inline void BenchCheckRenderStats(benchmark::State &state,
+                                  uint32_t maxDrawCalls) {
+  const RenderCounters frame = RenderStats::GetLastFrame();
+  state.counters["draw_calls"] = frame.drawCalls;
+  state.counters["program_switches"] = frame.programSwitches;
+  state.counters["texture_binds"] = frame.textureBinds;
+  state.counters["buffer_bytes"] = (double)frame.bufferBytes;
+  if (frame.drawCalls > maxDrawCalls) {
+    BenchFail(state, "more draw calls per frame than expected");
+  }
+}
@@ -0,0 +1,72 @@
+#include "bench.hpp"
+
+#include <font.hpp>
+#include <sprite-batch.hpp>
+
+#include <memory>
+
+#define BENCH_FONT_PATH "assets/fonts/cyberdyne.ttf"
+
+// about as long as the longest line the game draws
+static const char *benchText = "HIGH SCORE: 123456 - Press SPACE to start";
+
+// lines of benchText per iteration, stays under one batch so RenderText
+// never flushes inside the timed region
+#define BENCH_TEXT_LINES 64
+
+// null when the font could not be opened
+static std::unique_ptr<Font> loadFont(FontMode mode) {
+  const int size = mode == FontMode::SDF ? FONT_SDF_SIZE : 32;
+  auto font = std::make_unique<Font>(BENCH_FONT_PATH, size, mode);
+  // rasterize the glyphs up front, the cache fill is not what is measured
+  if (font->GetTextDimensions(benchText).x == 0) {
+    return nullptr;
+  }
+  return font;
+}
+
+static void BM_FontRenderText(benchmark::State &state) {
+  if (!BenchRequireGL(state)) {
+    return;
+  }
+  std::unique_ptr<Font> font = loadFont((FontMode)state.range(0));
+  if (!font) {
+    BenchFail(state, "could not load font");
+    return;
+  }
+  SpriteBatch batch(glm::vec2(BENCH_WIDTH, BENCH_HEIGHT));
+  const glm::vec2 scale = font->GetScale(32.0f);
+
+  for (auto _ : state) {
+    for (int line = 0; line < BENCH_TEXT_LINES; line++) {
+      font->RenderText(&batch, benchText, glm::vec2(0, line * 10.0f), scale,
+                       glm::vec4(1, 1, 1, 1));
+    }
+    state.PauseTiming();
+    batch.Flush();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * BENCH_TEXT_LINES);
+}
+BENCHMARK(BM_FontRenderText)
+    ->Arg((int)FontMode::Bitmap)
+    ->Arg((int)FontMode::SDF);
+
+static void BM_FontGetTextDimensions(benchmark::State &state) {
+  if (!BenchRequireGL(state)) {
+    return;
+  }
+  std::unique_ptr<Font> font = loadFont((FontMode)state.range(0));
+  if (!font) {
+    BenchFail(state, "could not load font");
+    return;
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(font->GetTextDimensions(benchText));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FontGetTextDimensions)
+    ->Arg((int)FontMode::Bitmap)
+    ->Arg((int)FontMode::SDF);
@@ -0,0 +1,72 @@
+#include "bench.hpp"
+
+#include <input.hpp>
+#include <mic-level.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// a full keyboard snapshot per iteration, movement keys toggle so every state
+// transition is taken
+static void BM_InputManagerUpdate(benchmark::State &state) {
+  uint8_t keyState[SDL_NUM_SCANCODES] = {};
+  bool pressed = false;
+
+  for (auto _ : state) {
+    pressed = !pressed;
+    keyState[SDL_SCANCODE_D] = pressed;
+    keyState[SDL_SCANCODE_W] = pressed;
+    keyState[SDL_SCANCODE_SPACE] = !pressed;
+    InputManager::Update(keyState, SDL_NUM_SCANCODES);
+    benchmark::DoNotOptimize(InputManager::GetVectorMovement());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InputManagerUpdate);
+
+// one capture buffer of a sung note, the size app.cpp asks SDL for
+static std::vector<float> makeCaptureBuffer() {
+  std::vector<float> samples(512);
+  for (size_t i = 0; i < samples.size(); i++) {
+    samples[i] = 0.6f * std::sin((float)i * 0.063f);
+  }
+  return samples;
+}
+
+// what audio_callback did before the level pipeline: a scalar peak only
+static void BM_MicPeakScalar(benchmark::State &state) {
+  const std::vector<float> samples = makeCaptureBuffer();
+  for (auto _ : state) {
+    float max = 0.0f;
+    for (const float sample : samples) {
+      max = std::max(max, std::abs(sample));
+    }
+    benchmark::DoNotOptimize(max);
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_MicPeakScalar);
+
+static void BM_MicLevelMeasure(benchmark::State &state) {
+  const std::vector<float> samples = makeCaptureBuffer();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        MicLevel::Measure(samples.data(), samples.size()));
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_MicLevelMeasure);
+
+// the audio thread pushing a buffer and the frame loop draining it
+static void BM_MicLevelPushUpdate(benchmark::State &state) {
+  const std::vector<float> samples = makeCaptureBuffer();
+  for (auto _ : state) {
+    MicLevel::PushSamples(samples.data(), samples.size());
+    MicLevel::Update();
+    benchmark::DoNotOptimize(MicLevel::GetLevel());
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_MicLevelPushUpdate);
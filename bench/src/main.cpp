@@ -0,0 +1,58 @@
+#include "bench.hpp"
+
+#include <SDL.h>
+#include <filesystem>
+#include <headless-context.hpp>
+#include <system_error>
+
+static bool hasGL = false;
+static bool skippedGL = false;
+static bool failed = false;
+
+bool BenchHasGL() { return hasGL; }
+
+bool BenchRequireGL(benchmark::State &state) {
+  if (!hasGL) {
+    skippedGL = true;
+    state.SkipWithError("no GL context");
+    return false;
+  }
+  return true;
+}
+
+void BenchFail(benchmark::State &state, const char *message) {
+  failed = true;
+  state.SkipWithError(message);
+}
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+
+  // assets and shaders are loaded relative to the repository root, like the
+  // game does from its build directory
+  std::error_code error;
+  std::filesystem::current_path(BENCH_ROOT_DIR, error);
+  if (error) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "could not enter %s: %s",
+                 BENCH_ROOT_DIR, error.message().c_str());
+    return 1;
+  }
+
+  // model and texture loading log every asset, keep the report readable
+  SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
+
+  HeadlessContext context(BENCH_WIDTH, BENCH_HEIGHT);
+  hasGL = context.IsValid();
+  benchmark::AddCustomContext("gl", hasGL ? "egl surfaceless" : "none");
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (failed) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "benchmarks failed");
+    return 1;
+  }
+  return skippedGL ? BENCH_EXIT_NO_GL : 0;
+}
@@ -0,0 +1,180 @@
+#include "bench.hpp"
+
+#include <glm/ext/matrix_transform.hpp>
+#include <mesh-renderer.hpp>
+#include <model.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// the game's NPC model
+#define BENCH_NPC_MODEL "assets/models/poly/poly.glb"
+// NPCs per row of the crowd
+#define BENCH_NPC_ROW 8
+// every how many NPCs one glows with an emissive override
+#define BENCH_NPC_GLOW_EVERY 3
+
+// a grid of NPCs in front of the MeshRenderer camera
+static std::vector<glm::mat4> makeCrowd(size_t count) {
+  std::vector<glm::mat4> transforms(count);
+  for (size_t i = 0; i < count; i++) {
+    const float x = ((float)(i % BENCH_NPC_ROW) - BENCH_NPC_ROW * 0.5f) * 1.5f;
+    const float z = -(float)(i / BENCH_NPC_ROW) * 1.5f;
+    transforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+  }
+  return transforms;
+}
+
+// the emissive override of an NPC, a few glow and the rest keep the material
+static glm::vec4 crowdEmissive(size_t npc, bool overrides) {
+  if (!overrides || npc % BENCH_NPC_GLOW_EVERY != 0) {
+    return MESH_MATERIAL_EMISSIVE;
+  }
+  return glm::vec4(1.0f, 0.5f, 0.0f, 0.8f);
+}
+
+// how a frame of the crowd is drawn
+enum class CrowdDraw {
+  // every mesh of every NPC on its own with DrawMesh
+  PerDraw,
+  // queued so Flush merges each mesh into one instanced draw
+  Flushed,
+  // each mesh once with DrawMeshInstanced
+  Instanced,
+};
+
+static void drawCrowd(MeshRenderer &renderer, Model &model,
+                      const std::vector<glm::mat4> &crowd, CrowdDraw how,
+                      bool overrides = false) {
+  if (how == CrowdDraw::Instanced) {
+    std::vector<InstanceData> instances;
+    for (const auto &mesh : model.getMeshes()) {
+      instances.clear();
+      for (size_t i = 0; i < crowd.size(); i++) {
+        instances.emplace_back(crowd[i] * mesh->model,
+                               crowdEmissive(i, overrides));
+      }
+      renderer.DrawMeshInstanced(mesh.get(), instances);
+    }
+  } else {
+    for (size_t i = 0; i < crowd.size(); i++) {
+      for (const auto &mesh : model.getMeshes()) {
+        const glm::mat4 transform = crowd[i] * mesh->model;
+        const glm::vec4 emissive = crowdEmissive(i, overrides);
+        if (how == CrowdDraw::Flushed) {
+          renderer.Submit(mesh.get(), transform, emissive);
+        } else {
+          renderer.DrawMesh(mesh.get(), transform, emissive);
+        }
+      }
+    }
+  }
+  renderer.Flush();
+  RenderStats::EndFrame();
+}
+
+static std::vector<uint8_t> readFrame() {
+  std::vector<uint8_t> pixels((size_t)BENCH_WIDTH * BENCH_HEIGHT * 4);
+  glReadPixels(0, 0, BENCH_WIDTH, BENCH_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE,
+               pixels.data());
+  return pixels;
+}
+
+// draws the crowd one way and fails unless it took draws draw calls and
+// produced the expected pixels
+static bool checkCrowd(benchmark::State &state, MeshRenderer &renderer,
+                       Model &model, const std::vector<glm::mat4> &crowd,
+                       CrowdDraw how, bool overrides, uint32_t draws,
+                       const std::vector<uint8_t> &expected,
+                       const char *error) {
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  drawCrowd(renderer, model, crowd, how, overrides);
+  if (RenderStats::GetLastFrame().drawCalls != draws) {
+    BenchFail(state, "NPCs took an unexpected number of draws");
+    return false;
+  }
+  if (readFrame() != expected) {
+    BenchFail(state, error);
+    return false;
+  }
+  return true;
+}
+
+// draws the crowd every way, with and without emissive overrides, and fails
+// unless the merged and instanced draws match the per draw pixels
+static bool checkInstancing(benchmark::State &state, MeshRenderer &renderer,
+                            Model &model,
+                            const std::vector<glm::mat4> &crowd) {
+  const uint32_t meshCount = model.getMeshes().size();
+  const uint32_t perDraw = meshCount * crowd.size();
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  drawCrowd(renderer, model, crowd, CrowdDraw::PerDraw);
+  const std::vector<uint8_t> plain = readFrame();
+  if (std::all_of(plain.begin(), plain.end(),
+                  [](uint8_t value) { return value == 0; })) {
+    BenchFail(state, "no NPCs were drawn");
+    return false;
+  }
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  drawCrowd(renderer, model, crowd, CrowdDraw::PerDraw, true);
+  const std::vector<uint8_t> glowing = readFrame();
+  if (glowing == plain) {
+    BenchFail(state, "emissive overrides did not change the NPCs");
+    return false;
+  }
+
+  return checkCrowd(state, renderer, model, crowd, CrowdDraw::PerDraw, false,
+                    perDraw, plain, "per draw NPCs are not deterministic") &&
+         checkCrowd(state, renderer, model, crowd, CrowdDraw::Flushed, false,
+                    meshCount, plain,
+                    "flushed NPCs differ from per draw NPCs") &&
+         checkCrowd(state, renderer, model, crowd, CrowdDraw::Instanced,
+                    false, meshCount, plain,
+                    "instanced NPCs differ from per draw NPCs") &&
+         checkCrowd(state, renderer, model, crowd, CrowdDraw::Flushed, true,
+                    meshCount, glowing,
+                    "flushed NPCs lost their emissive overrides") &&
+         checkCrowd(state, renderer, model, crowd, CrowdDraw::Instanced, true,
+                    meshCount, glowing,
+                    "instanced NPCs lost their emissive overrides");
+}
+
+// the player and enemy NPCs scaled up to a crowd, range(1) picks the per
+// draw or the flushed path. every path is checked against the others first
+static void BM_MeshRendererNPCs(benchmark::State &state) {
+  if (!BenchRequireGL(state)) {
+    return;
+  }
+  Model model(BENCH_NPC_MODEL);
+  if (model.getMeshes().empty()) {
+    BenchFail(state, "could not load model");
+    return;
+  }
+  MeshRenderer renderer;
+  const std::vector<glm::mat4> crowd = makeCrowd(state.range(0));
+  const bool instanced = state.range(1) != 0;
+
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  if (!checkInstancing(state, renderer, model, crowd)) {
+    glDisable(GL_DEPTH_TEST);
+    return;
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    state.ResumeTiming();
+    drawCrowd(renderer, model, crowd,
+              instanced ? CrowdDraw::Flushed : CrowdDraw::PerDraw);
+    glFinish();
+  }
+  state.SetItemsProcessed(state.iterations() * crowd.size());
+  const uint32_t meshCount = model.getMeshes().size();
+  BenchCheckRenderStats(state, instanced ? meshCount
+                                         : meshCount * (uint32_t)crowd.size());
+  glDisable(GL_DEPTH_TEST);
+}
+BENCHMARK(BM_MeshRendererNPCs)->Args({64, 0})->Args({64, 1});
@@ -0,0 +1,31 @@
+#include "bench.hpp"
+
+#include <archive.hpp>
+#include <model.hpp>
+
+#include <string>
+
+// parses one of the shipped models from memory, file io is not measured
+static void BM_ModelParseGLTF(benchmark::State &state, const char *path) {
+  AssetBlob blob;
+  if (!AssetArchive::Open(path, &blob)) {
+    BenchFail(state, "could not open model");
+    return;
+  }
+  const std::string pathStr = path;
+  const std::string baseDir = pathStr.substr(0, pathStr.find_last_of("/"));
+
+  for (auto _ : state) {
+    ModelData data;
+    if (!Model::ParseGLTF(blob.data, baseDir, &data)) {
+      BenchFail(state, "could not parse model");
+      break;
+    }
+    benchmark::DoNotOptimize(data.meshes.data());
+  }
+  state.SetBytesProcessed(state.iterations() * blob.data.size());
+}
+BENCHMARK_CAPTURE(BM_ModelParseGLTF, sphere, "assets/models/sphere.glb");
+BENCHMARK_CAPTURE(BM_ModelParseGLTF, poly, "assets/models/poly/poly.glb");
+BENCHMARK_CAPTURE(BM_ModelParseGLTF, vapor,
+                  "assets/models/vaporwave/vapor.glb");
@@ -0,0 +1,168 @@
+#include "bench.hpp"
+
+#include <sprite-batch.hpp>
+
+#include <cmath>
+#include <vector>
+
+// one batch worth of sprites from a 1024x1024 atlas, the same shape as a busy
+// frame of the game
+static std::vector<SpriteInstance> makeSprites(size_t count) {
+  std::vector<SpriteInstance> sprites(count);
+  for (size_t i = 0; i < count; i++) {
+    const float x = (float)(i % 64) * 16.0f;
+    const float y = (float)(i / 64 % 64) * 16.0f;
+    sprites[i] = {.destRect = glm::vec4(x, y, 16.0f, 16.0f),
+                  .srcRect = glm::vec4(x, y, 16.0f, 16.0f),
+                  .color = glm::u8vec4(255, 255, 255, 255)};
+  }
+  return sprites;
+}
+
+// what SpriteBatch::Draw did for every sprite before the axis aligned fast
+// path: rotate about the center and pack each vertex on its own
+static void BM_QuadsRotatedPerSprite(benchmark::State &state) {
+  const std::vector<SpriteInstance> sprites = makeSprites(state.range(0));
+  std::vector<Vertex> vertices;
+  vertices.reserve(sprites.size() * 4);
+  const glm::vec2 invTextureSize(1.0f / 1024.0f);
+
+  for (auto _ : state) {
+    vertices.clear();
+    for (const SpriteInstance &sprite : sprites) {
+      const glm::vec2 half(sprite.destRect.z * 0.5f, sprite.destRect.w * 0.5f);
+      const glm::vec2 center = glm::vec2(sprite.destRect) + half;
+      const float rotation = 0.0f;
+      const glm::mat2 rotationMatrix(std::cos(rotation), -std::sin(rotation),
+                                     std::sin(rotation), std::cos(rotation));
+      const glm::vec2 uvMin = glm::vec2(sprite.srcRect) * invTextureSize;
+      const glm::vec2 uvMax =
+          (glm::vec2(sprite.srcRect) + glm::vec2(sprite.srcRect.z,
+                                                 sprite.srcRect.w)) *
+          invTextureSize;
+      const glm::vec4 color = glm::vec4(sprite.color) / 255.0f;
+      vertices.push_back(Vertex(rotationMatrix * -half + center, uvMin, color,
+                                0));
+      vertices.push_back(
+          Vertex(rotationMatrix * glm::vec2(half.x, -half.y) + center,
+                 glm::vec2(uvMax.x, uvMin.y), color, 0));
+      vertices.push_back(
+          Vertex(rotationMatrix * glm::vec2(-half.x, half.y) + center,
+                 glm::vec2(uvMin.x, uvMax.y), color, 0));
+      vertices.push_back(Vertex(rotationMatrix * half + center, uvMax, color,
+                                0));
+    }
+    benchmark::DoNotOptimize(vertices.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * sprites.size());
+}
+BENCHMARK(BM_QuadsRotatedPerSprite)
+    ->Arg(SPRITE_BATCH_MAX_SPRITES)
+    ->Arg(1 << 20);
+
+// the DrawMany inner loop
+static void BM_GenerateSpriteQuads(benchmark::State &state) {
+  const std::vector<SpriteInstance> sprites = makeSprites(state.range(0));
+  std::vector<Vertex> vertices(sprites.size() * 4);
+  const glm::vec2 invTextureSize(1.0f / 1024.0f);
+
+  for (auto _ : state) {
+    GenerateSpriteQuads(sprites.data(), sprites.size(), invTextureSize, 0,
+                        vertices.data());
+    benchmark::DoNotOptimize(vertices.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * sprites.size());
+}
+BENCHMARK(BM_GenerateSpriteQuads)
+    ->Arg(SPRITE_BATCH_MAX_SPRITES)
+    ->Arg(1 << 20);
+
+// a texture for the batch to reference, the contents are never sampled
+static GLuint makeTexture() {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1024, 1024, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+// one full batch of Draw calls per iteration, the flush is not timed. arg is
+// the rotation so both the fast path and the rotated path are covered
+static void BM_SpriteBatchDraw(benchmark::State &state) {
+  if (!BenchRequireGL(state)) {
+    return;
+  }
+  SpriteBatch batch(glm::vec2(BENCH_WIDTH, BENCH_HEIGHT));
+  const GLuint texture = makeTexture();
+  const std::vector<SpriteInstance> sprites =
+      makeSprites(SPRITE_BATCH_MAX_SPRITES);
+  const float rotation = (float)state.range(0) * 0.01f;
+
+  for (auto _ : state) {
+    batch.SetTextureAndDimensions(texture, 1024, 1024);
+    for (const SpriteInstance &sprite : sprites) {
+      batch.Draw(texture, glm::vec2(sprite.destRect), glm::vec2(1, 1),
+                 rotation, glm::vec4(1, 1, 1, 1), sprite.srcRect);
+    }
+    state.PauseTiming();
+    batch.Flush();
+    RenderStats::EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * sprites.size());
+  // a full batch of one texture is a single draw
+  BenchCheckRenderStats(state, 1);
+  glDeleteTextures(1, &texture);
+}
+BENCHMARK(BM_SpriteBatchDraw)->Arg(0)->Arg(1);
+
+static void BM_SpriteBatchDrawMany(benchmark::State &state) {
+  if (!BenchRequireGL(state)) {
+    return;
+  }
+  SpriteBatch batch(glm::vec2(BENCH_WIDTH, BENCH_HEIGHT));
+  const GLuint texture = makeTexture();
+  const std::vector<SpriteInstance> sprites =
+      makeSprites(SPRITE_BATCH_MAX_SPRITES);
+
+  for (auto _ : state) {
+    batch.SetTextureAndDimensions(texture, 1024, 1024);
+    batch.DrawMany(texture, sprites);
+    state.PauseTiming();
+    batch.Flush();
+    RenderStats::EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * sprites.size());
+  // a full batch of one texture is a single draw
+  BenchCheckRenderStats(state, 1);
+  glDeleteTextures(1, &texture);
+}
+BENCHMARK(BM_SpriteBatchDrawMany);
+
+static void BM_SpriteBatchDrawRect(benchmark::State &state) {
+  if (!BenchRequireGL(state)) {
+    return;
+  }
+  SpriteBatch batch(glm::vec2(BENCH_WIDTH, BENCH_HEIGHT));
+  const std::vector<SpriteInstance> sprites =
+      makeSprites(SPRITE_BATCH_MAX_SPRITES);
+
+  for (auto _ : state) {
+    for (const SpriteInstance &sprite : sprites) {
+      batch.DrawRect(sprite.destRect, glm::vec4(1, 0, 1, 1));
+    }
+    state.PauseTiming();
+    batch.Flush();
+    RenderStats::EndFrame();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * sprites.size());
+  // a full batch of one texture is a single draw
+  BenchCheckRenderStats(state, 1);
+}
+BENCHMARK(BM_SpriteBatchDrawRect);
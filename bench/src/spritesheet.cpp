@@ -0,0 +1,43 @@
+#include "bench.hpp"
+
+#include <spritesheet.hpp>
+
+#include <string>
+
+// atlas json in the format the sprite packer writes, count sprites in a grid
+// with an animation for every 8 of them
+static std::string makeAtlasJson(int count) {
+  std::string json = "{\"texture\": \"atlas.png\", \"atlas\": [";
+  for (int i = 0; i < count; i++) {
+    json += (i ? ", " : "") + std::to_string(i % 64 * 16) + ", " +
+            std::to_string(i / 64 * 16) + ", 16, 16";
+  }
+  json += "], \"animations\": {";
+  for (int i = 0; i < count / 8; i++) {
+    json += (i ? ", \"anim" : "\"anim") + std::to_string(i) +
+            "\": {\"frames\": [";
+    for (int frame = 0; frame < 8; frame++) {
+      json += (frame ? ", " : "") + std::to_string(i * 8 + frame);
+    }
+    json += "], \"frameTime\": 0.1, \"loop\": true}";
+  }
+  json += "}}";
+  return json;
+}
+
+static void BM_SpriteSheetParseAtlas(benchmark::State &state) {
+  const std::string json = makeAtlasJson(state.range(0));
+  const std::span<const uint8_t> data((const uint8_t *)json.data(),
+                                      json.size());
+
+  for (auto _ : state) {
+    SpriteAtlasData atlas;
+    if (!SpriteSheet::ParseAtlas(data, &atlas)) {
+      BenchFail(state, "could not parse atlas");
+      break;
+    }
+    benchmark::DoNotOptimize(atlas.atlas.data());
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_SpriteSheetParseAtlas)->Arg(64)->Arg(1024);
@@ -1,4 +1,9 @@
 #pragma once
 
+#include <cstddef>
+
 void LockAllAssets();
-void UnlockAllAssets();
\ No newline at end of file
+void UnlockAllAssets();
+
+// memory budget shared by every asset type, see AssetResidency
+void SetAssetBudget(size_t bytes);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <asset-manager.hpp>
 #include <font.hpp>
 #include <memory>
 #include <mesh-renderer.hpp>
@@ -7,6 +8,31 @@
 #include <model.hpp>
 #include <shared-data.hpp>
 #include <sprite-batch.hpp>
+#include <text-layout.hpp>
+
+// time per frame spent finalizing background loads (GL uploads)
+#define ASSET_LOAD_BUDGET_MS 4.0f
+
+// text sizes in pixels, all drawn from the one sdf font
+#define FONT_SIZE_HUD 32
+#define FONT_SIZE_TITLE 60
+#define FONT_SIZE_STATS 16
+
+// simulation ticks per second, --tick-rate overrides it
+#define GAME_TICK_RATE 60
+
+// longest frame the simulation catches up on, slower frames lose the rest
+// instead of running a burst of ticks
+#define GAME_MAX_FRAME_TIME 0.25f
+
+// the parts of the simulation that move, kept for the last tick so frames
+// drawn between ticks can be interpolated
+struct SimulationState {
+  float playerX;
+  float enemyX;
+  float camX;
+  glm::vec3 ballPos;
+};
 
 class Game {
 public:
@@ -14,18 +40,32 @@ public:
   ~Game();
   int init(SharedData *shared_data);
   int update();
+  // advance the game by one fixed step, volume is the clamped mic level
+  void tick(float delta, float volume);
+  SimulationState captureState() const;
   int unload();
   int close();
 
+  // take the loaded assets once every background load is done
+  bool finishLoading();
+  void drawLoadingScreen();
+
   std::unique_ptr<SpriteBatch> spriteBatcher;
 
   std::unique_ptr<MeshRenderer> meshRenderer;
 
   std::unique_ptr<Mixer> mixer;
 
+  // one distance field font draws every text size
   std::shared_ptr<Font> font;
 
-  std::shared_ptr<Font> fontBig;
+  // cached text quads, rebuilt only when the string changes
+  TextLayout pauseText;
+  TextLayout titleText;
+  TextLayout micText;
+  TextLayout scoreText;
+  TextLayout highScoreText;
+  TextLayout statsText;
 
   std::shared_ptr<Model> worldModel;
 
@@ -35,6 +75,18 @@ public:
 
   std::shared_ptr<Music> music;
 
+  // background loads started in init
+  AssetHandle<Font> fontHandle;
+  AssetHandle<Model> worldModelHandle;
+  AssetHandle<Model> npcModelHandle;
+  AssetHandle<Model> ballModelHandle;
+  AssetHandle<Music> musicHandle;
+
+  SharedData *sharedData = nullptr;
+
+  bool isLoading = true;
+  glm::vec2 windowSize = glm::vec2(0.0f);
+
   const float camMaxX = 12.0f;
   const float ballMaxX = 9.0f;
 
@@ -58,5 +110,14 @@ public:
   int highScore = 0;
 
   bool isPlaying = false;
+  // F3 shows the profiler's recent frame times and the last frame's render
+  // stats
+  bool showFrameGraph = false;
+  // seconds played, follows the frame time
   float lastTime = 0.0f;
+  // performance counter at the last update, 0 before the first one
+  Uint64 lastCounter = 0;
+  // frame time not yet simulated, always less than a tick
+  float accumulator = 0.0f;
+  SimulationState previousState = {};
 };
\ No newline at end of file
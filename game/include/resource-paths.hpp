@@ -2,6 +2,9 @@
 
 // resource paths:
 
+// packed assets, loose files are used for anything not in it
+#define RES_ARCHIVE "assets.pak"
+
 #define RES_FONT_CYBERDYNE "assets/fonts/cyberdyne.ttf"
 
 #define RES_MODEL_VAPOR "assets/models/vaporwave/vapor.glb"
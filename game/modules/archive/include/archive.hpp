@@ -0,0 +1,98 @@
+#pragma once
+
+#include "mapped-file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+// packed asset archive written by the asset packer, layout on disk:
+//   ArchiveHeader
+//   ArchiveEntry[entryCount], sorted by hash
+//   path strings, not terminated
+//   entry data, each entry aligned to ARCHIVE_ALIGNMENT
+#define ARCHIVE_MAGIC 0x4B504254 // "TBPK"
+// bump whenever the layout changes
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_ALIGNMENT 16
+#define ARCHIVE_EXTENSION "pak"
+
+#define ARCHIVE_HASH_OFFSET 0xcbf29ce484222325ULL
+#define ARCHIVE_HASH_PRIME 0x100000001b3ULL
+
+enum class ArchiveCompression : uint32_t {
+  None,
+  // only readable when built with ASSET_ARCHIVE_ZSTD
+  Zstd,
+};
+
+struct ArchiveHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t padding;
+  uint64_t fileSize;
+};
+
+struct ArchiveEntry {
+  uint64_t hash;
+  // offset from the start of the file and stored size
+  uint64_t offset;
+  uint64_t size;
+  // size once decompressed, equal to size when not compressed
+  uint64_t originalSize;
+  uint32_t pathOffset;
+  uint32_t pathLength;
+  ArchiveCompression compression;
+  uint32_t padding;
+};
+
+// FNV-1a of the path the asset is requested with, e.g. "assets/fonts/x.ttf"
+constexpr uint64_t HashArchivePath(std::string_view path) {
+  uint64_t hash = ARCHIVE_HASH_OFFSET;
+  for (const char c : path) {
+    hash = (hash ^ (uint8_t)c) * ARCHIVE_HASH_PRIME;
+  }
+  return hash;
+}
+
+// bytes of an asset, owner keeps whatever backs them alive (the archive
+// mapping, a mapped loose file or a decompressed copy)
+struct AssetBlob {
+  std::span<const uint8_t> data;
+  std::shared_ptr<const void> owner;
+
+  bool IsValid() const { return this->data.data() != nullptr; }
+};
+
+class AssetArchive {
+public:
+  AssetArchive(const char *path);
+
+  bool IsValid() const { return this->header != nullptr; }
+
+  // look an asset up by path, uncompressed entries point into the mapping
+  bool Read(std::string_view path, AssetBlob *out) const;
+
+  // size of the asset before packing, 0 when it is not in the archive
+  size_t GetOriginalSize(std::string_view path) const;
+
+  // archive searched by Open, assets not in it are read from loose files
+  static void Mount(std::shared_ptr<AssetArchive> archive);
+  static void Unmount();
+
+  // read an asset from the mounted archive, or map the loose file
+  static bool Open(std::string_view path, AssetBlob *out);
+
+  // size of an asset in the mounted archive or on disk, 0 if missing
+  static size_t GetAssetSize(std::string_view path);
+
+private:
+  const ArchiveEntry *find(std::string_view path) const;
+
+  std::shared_ptr<MappedFile> file;
+  const ArchiveHeader *header = nullptr;
+  const ArchiveEntry *entries = nullptr;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// read only view of a whole file, memory mapped where the platform allows it
+class MappedFile {
+public:
+  MappedFile(const char *path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool IsValid() const { return this->data != nullptr; }
+  const uint8_t *GetData() const { return this->data; }
+  size_t GetSize() const { return this->size; }
+
+private:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+#ifdef EMSCRIPTEN
+  // the preloaded file system lives in memory already, just copy it out
+  std::vector<uint8_t> buffer;
+#elif defined(_WIN32)
+  void *file = nullptr;
+  void *mapping = nullptr;
+#endif
+};
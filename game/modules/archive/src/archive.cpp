@@ -0,0 +1,163 @@
+#include "archive.hpp"
+
+#include <SDL.h>
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef ASSET_ARCHIVE_ZSTD
+#include <zstd.h>
+#endif
+
+// the mounted archive, every asset load reads through it
+static std::mutex mountedMutex;
+static std::shared_ptr<AssetArchive> mounted;
+
+AssetArchive::AssetArchive(const char *path) {
+  this->file = std::make_shared<MappedFile>(path);
+  if (!this->file->IsValid()) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not open archive %s",
+                 path);
+    return;
+  }
+
+  const uint8_t *data = this->file->GetData();
+  const size_t size = this->file->GetSize();
+  const auto *header = reinterpret_cast<const ArchiveHeader *>(data);
+  if (size < sizeof(ArchiveHeader) || header->magic != ARCHIVE_MAGIC ||
+      header->version != ARCHIVE_VERSION || header->fileSize != size ||
+      sizeof(ArchiveHeader) + header->entryCount * sizeof(ArchiveEntry) >
+          size) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "Archive %s is corrupt or from another version", path);
+    return;
+  }
+
+  // validate every entry once so reads do not have to
+  const auto *entries =
+      reinterpret_cast<const ArchiveEntry *>(data + sizeof(ArchiveHeader));
+  for (uint32_t i = 0; i < header->entryCount; i++) {
+    const ArchiveEntry &entry = entries[i];
+    if (entry.offset + entry.size > size ||
+        (uint64_t)entry.pathOffset + entry.pathLength > size ||
+        (i > 0 && entries[i - 1].hash > entry.hash)) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                   "Archive %s has a corrupt entry", path);
+      return;
+    }
+  }
+
+  this->header = header;
+  this->entries = entries;
+  SDL_Log("Opened archive %s (%u entries)", path, header->entryCount);
+}
+
+const ArchiveEntry *AssetArchive::find(std::string_view path) const {
+  if (!this->IsValid()) {
+    return nullptr;
+  }
+
+  const uint64_t hash = HashArchivePath(path);
+  const ArchiveEntry *end = this->entries + this->header->entryCount;
+  const ArchiveEntry *entry = std::lower_bound(
+      this->entries, end, hash,
+      [](const ArchiveEntry &e, uint64_t h) { return e.hash < h; });
+
+  // the stored path tells hash collisions apart
+  const char *strings = (const char *)this->file->GetData();
+  for (; entry != end && entry->hash == hash; entry++) {
+    if (std::string_view(strings + entry->pathOffset, entry->pathLength) ==
+        path) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+bool AssetArchive::Read(std::string_view path, AssetBlob *out) const {
+  const ArchiveEntry *entry = this->find(path);
+  if (entry == nullptr) {
+    return false;
+  }
+
+  const uint8_t *data = this->file->GetData() + entry->offset;
+  if (entry->compression == ArchiveCompression::None) {
+    // zero copy, the blob keeps the mapping alive
+    out->data = std::span<const uint8_t>(data, entry->size);
+    out->owner = this->file;
+    return true;
+  }
+
+#ifdef ASSET_ARCHIVE_ZSTD
+  if (entry->compression == ArchiveCompression::Zstd) {
+    auto buffer = std::make_shared<std::vector<uint8_t>>(entry->originalSize);
+    const size_t result = ZSTD_decompress(buffer->data(), buffer->size(), data,
+                                          entry->size);
+    if (ZSTD_isError(result) || result != entry->originalSize) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                   "Could not decompress %.*s: %s", (int)path.size(),
+                   path.data(), ZSTD_getErrorName(result));
+      return false;
+    }
+    out->data = std::span<const uint8_t>(buffer->data(), buffer->size());
+    out->owner = buffer;
+    return true;
+  }
+#endif
+
+  SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+               "Unsupported compression for %.*s", (int)path.size(),
+               path.data());
+  return false;
+}
+
+size_t AssetArchive::GetOriginalSize(std::string_view path) const {
+  const ArchiveEntry *entry = this->find(path);
+  return entry != nullptr ? entry->originalSize : 0;
+}
+
+void AssetArchive::Mount(std::shared_ptr<AssetArchive> archive) {
+  std::lock_guard<std::mutex> lock(mountedMutex);
+  mounted = archive;
+}
+
+void AssetArchive::Unmount() {
+  std::lock_guard<std::mutex> lock(mountedMutex);
+  mounted.reset();
+}
+
+static std::shared_ptr<AssetArchive> getMounted() {
+  std::lock_guard<std::mutex> lock(mountedMutex);
+  return mounted;
+}
+
+bool AssetArchive::Open(std::string_view path, AssetBlob *out) {
+  std::shared_ptr<AssetArchive> archive = getMounted();
+  if (archive && archive->Read(path, out)) {
+    return true;
+  }
+
+  // not packed, map the loose file
+  auto file = std::make_shared<MappedFile>(std::string(path).c_str());
+  if (!file->IsValid()) {
+    return false;
+  }
+  out->data = std::span<const uint8_t>(file->GetData(), file->GetSize());
+  out->owner = file;
+  return true;
+}
+
+size_t AssetArchive::GetAssetSize(std::string_view path) {
+  std::shared_ptr<AssetArchive> archive = getMounted();
+  if (archive) {
+    const size_t size = archive->GetOriginalSize(path);
+    if (size != 0) {
+      return size;
+    }
+  }
+  std::error_code error;
+  const auto size = std::filesystem::file_size(path, error);
+  return error ? 0 : size;
+}
@@ -0,0 +1,108 @@
+#include "mapped-file.hpp"
+
+#include <SDL.h>
+
+#ifdef EMSCRIPTEN
+#include <cstdio>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef EMSCRIPTEN
+
+MappedFile::MappedFile(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  const long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (length > 0) {
+    this->buffer.resize(length);
+    if (fread(this->buffer.data(), 1, length, file) == (size_t)length) {
+      this->data = this->buffer.data();
+      this->size = length;
+    }
+  }
+  fclose(file);
+}
+
+MappedFile::~MappedFile() {}
+
+#elif defined(_WIN32)
+
+MappedFile::MappedFile(const char *path) {
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  this->file = file;
+
+  LARGE_INTEGER length;
+  if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+    return;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not map file %s", path);
+    return;
+  }
+  this->mapping = mapping;
+
+  this->data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (this->data != nullptr) {
+    this->size = (size_t)length.QuadPart;
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (this->data != nullptr) {
+    UnmapViewOfFile(this->data);
+  }
+  if (this->mapping != nullptr) {
+    CloseHandle(this->mapping);
+  }
+  if (this->file != nullptr) {
+    CloseHandle(this->file);
+  }
+}
+
+#else
+
+MappedFile::MappedFile(const char *path) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      this->data = (const uint8_t *)mapped;
+      this->size = info.st_size;
+    } else {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not map file %s", path);
+    }
+  }
+  // the mapping keeps the file alive
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (this->data != nullptr) {
+    munmap((void *)this->data, this->size);
+  }
+}
+
+#endif
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <profiler.hpp>
+#include <thread>
+#include <vector>
+
+// Background loader, decode work runs on a pool of worker threads and the
+// returned finalize step (GL uploads) runs on the thread calling Update
+class AssetLoader {
+public:
+  // runs on the main thread once the work is done
+  using Finalize = std::function<void()>;
+  // runs on a worker, must not touch GL
+  using Work = std::function<Finalize()>;
+  // runs on the thread calling Shutdown when the load is dropped before it
+  // was finalized, so whoever waits on it is released
+  using Cancel = std::function<void()>;
+
+  static void Enqueue(Work work, Cancel cancel) {
+    instance->pending++;
+#ifdef EMSCRIPTEN
+    // no threads on the web build, decode now and finalize on the next update
+    Finalize finalize = work();
+    std::lock_guard<std::mutex> lock(instance->finalizeMutex);
+    instance->finalizeQueue.push_back({std::move(finalize), std::move(cancel)});
+#else
+    instance->start();
+    {
+      std::lock_guard<std::mutex> lock(instance->workMutex);
+      instance->workQueue.push_back({std::move(work), std::move(cancel)});
+    }
+    instance->workReady.notify_one();
+#endif
+  }
+
+  // finalize finished loads until budgetMs is used up, at least one load is
+  // finalized per call so loading always makes progress
+  static void Update(float budgetMs) {
+    instance->finalizeThread = std::this_thread::get_id();
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const Uint64 budget =
+        (Uint64)(budgetMs * SDL_GetPerformanceFrequency() / 1000.0f);
+
+    while (true) {
+      Finalize finalize;
+      {
+        std::lock_guard<std::mutex> lock(instance->finalizeMutex);
+        if (instance->finalizeQueue.empty()) {
+          break;
+        }
+        finalize = std::move(instance->finalizeQueue.front().finalize);
+        instance->finalizeQueue.pop_front();
+      }
+      if (finalize) {
+        PROFILE_ZONE("AssetLoader::Finalize");
+        finalize();
+      }
+      instance->pending--;
+
+      if (SDL_GetPerformanceCounter() - start >= budget) {
+        break;
+      }
+    }
+  }
+
+  // block until a load is done, when called from the thread that finalizes
+  // loads it keeps finalizing so it can not deadlock on itself
+  template <class R> static R Wait(const std::shared_future<R> &future) {
+    if (std::this_thread::get_id() == instance->finalizeThread.load()) {
+      while (future.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready) {
+        Update(0.0f);
+        std::this_thread::yield();
+      }
+    }
+    return future.get();
+  }
+
+  // true on the thread that finalizes loads (the frame loop), or on any
+  // thread before the first Update when that thread is not known yet
+  static bool IsFinalizeThread() {
+    const std::thread::id thread = instance->finalizeThread.load();
+    return thread == std::thread::id() ||
+           thread == std::this_thread::get_id();
+  }
+
+  // number of loads that have not been finalized yet
+  static int GetPendingCount() { return instance->pending; }
+
+  // stop the workers, loads that were not finalized yet are dropped and
+  // cancelled, call this before the game library is unloaded
+  static void Shutdown() {
+    for (Cancel &cancel : instance->stop()) {
+      if (cancel) {
+        cancel();
+      }
+    }
+  }
+
+  // at exit nobody waits on the dropped loads, and the caches their cancels
+  // would touch may already be gone
+  ~AssetLoader() { this->stop(); }
+
+private:
+  struct Job {
+    Work work;
+    Cancel cancel;
+  };
+
+  struct Finished {
+    Finalize finalize;
+    Cancel cancel;
+  };
+
+  inline const static std::unique_ptr<AssetLoader> instance =
+      std::make_unique<AssetLoader>();
+
+  void start() {
+    std::lock_guard<std::mutex> lock(this->workMutex);
+    if (!this->workers.empty()) {
+      return;
+    }
+    this->running = true;
+    // leave one core for the main thread, the core count may be unknown (0)
+    const unsigned int cores = std::thread::hardware_concurrency();
+    const unsigned int count = cores > 1 ? cores - 1 : 1;
+    for (unsigned int i = 0; i < count; i++) {
+      this->workers.emplace_back([this]() { this->workerLoop(); });
+    }
+  }
+
+  // returns the cancels of the dropped loads, run them with no lock held
+  std::vector<Cancel> stop() {
+    std::vector<Cancel> cancels;
+    {
+      std::lock_guard<std::mutex> lock(this->workMutex);
+      this->running = false;
+      for (Job &job : this->workQueue) {
+        cancels.push_back(std::move(job.cancel));
+      }
+      this->pending -= this->workQueue.size();
+      this->workQueue.clear();
+    }
+    this->workReady.notify_all();
+    // work in progress finishes and lands in the finalize queue
+    for (auto &worker : this->workers) {
+      worker.join();
+    }
+    this->workers.clear();
+
+    std::lock_guard<std::mutex> lock(this->finalizeMutex);
+    for (Finished &finished : this->finalizeQueue) {
+      cancels.push_back(std::move(finished.cancel));
+    }
+    this->pending -= this->finalizeQueue.size();
+    this->finalizeQueue.clear();
+    return cancels;
+  }
+
+  void workerLoop() {
+    while (true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(this->workMutex);
+        this->workReady.wait(lock, [this]() {
+          return !this->running || !this->workQueue.empty();
+        });
+        if (!this->running) {
+          return;
+        }
+        job = std::move(this->workQueue.front());
+        this->workQueue.pop_front();
+      }
+
+      Finalize finalize;
+      {
+        PROFILE_ZONE("AssetLoader::Work");
+        finalize = job.work();
+      }
+
+      std::lock_guard<std::mutex> lock(this->finalizeMutex);
+      this->finalizeQueue.push_back(
+          {std::move(finalize), std::move(job.cancel)});
+    }
+  }
+
+  std::vector<std::thread> workers;
+  bool running = false;
+
+  std::mutex workMutex;
+  std::condition_variable workReady;
+  std::deque<Job> workQueue;
+
+  std::mutex finalizeMutex;
+  std::deque<Finished> finalizeQueue;
+
+  std::atomic<int> pending = 0;
+  std::atomic<std::thread::id> finalizeThread;
+};
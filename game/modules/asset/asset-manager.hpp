@@ -1,56 +1,454 @@
 #pragma once
 
+#include "asset-loader.hpp"
+#include "asset-residency.hpp"
 #include "font.hpp"
+#include "mixer.hpp"
+#include "model.hpp"
+#include "spritesheet.hpp"
+#include "texture.hpp"
 #include <SDL2/SDL.h>
+#include <chrono>
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
-// Lazy-loaded asset manager, to minimize loading during transitions, ensure
-// there is at least one shared_ptr in scope
+// a font's glyphs live in the shared glyph cache pages, which outlive the
+// font and are budgeted on their own (see TrackGlyphPages)
+template <> inline AssetFootprint GetAssetFootprint(const Font &font) {
+  return {font.GetCPUBytes(), 0};
+}
+
+// fonts rasterize glyphs as text is drawn
+template <> struct AssetGrows<Font> : std::true_type {};
+
+// the glyph cache pages shared by every font, a resident entry that is never
+// evicted since the pages go away with the last font. measured on Trim only,
+// the pages belong to the frame loop
+inline void TrackGlyphPages() {
+  static std::once_flag once;
+  std::call_once(once, []() {
+    AssetResidency::Add(
+        AssetFootprint(), [](std::shared_ptr<void> *) { return false; },
+        []() { return AssetFootprint{0, GlyphCache::GetSharedGPUBytes()}; });
+  });
+}
+
+// number of independently locked partitions of each cache
+#define ASSET_MANAGER_SHARDS 16
+
+#define ASSET_HASH_OFFSET 0xcbf29ce484222325ULL
+#define ASSET_HASH_PRIME 0x100000001b3ULL
+
+// FNV-1a, cache keys are hashed once per lookup instead of stored as strings
+constexpr uint64_t HashAssetPath(std::string_view path,
+                                 uint64_t hash = ASSET_HASH_OFFSET) {
+  for (const char c : path) {
+    hash = (hash ^ (uint8_t)c) * ASSET_HASH_PRIME;
+  }
+  return hash;
+}
+
+// mix a variant (e.g. font size) into a path hash
+constexpr uint64_t HashAssetVariant(uint64_t hash, int variant) {
+  for (int i = 0; i < 4; i++) {
+    hash = (hash ^ ((uint32_t)variant >> (i * 8) & 0xFF)) * ASSET_HASH_PRIME;
+  }
+  return hash;
+}
+
+// How an asset type is loaded in the background, Decode runs on a worker and
+// must not touch GL, Create runs on the main thread with the decoded data.
+// By default the whole asset is constructed on the worker.
+template <class T> struct AssetTraits {
+  using Decoded = T;
+  static std::shared_ptr<Decoded> Decode(const std::string &path) {
+    return std::make_shared<T>(path.c_str());
+  }
+  static std::shared_ptr<T> Create(std::shared_ptr<Decoded> decoded) {
+    return decoded;
+  }
+};
+
+template <> struct AssetTraits<Texture> {
+  using Decoded = ImageData;
+  static std::shared_ptr<Decoded> Decode(const std::string &path) {
+    std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+    Texture::Decode(path.c_str(), image.get());
+    return image;
+  }
+  static std::shared_ptr<Texture> Create(std::shared_ptr<Decoded> decoded) {
+    return std::make_shared<Texture>(*decoded);
+  }
+};
+
+template <> struct AssetTraits<Model> {
+  using Decoded = ModelSource;
+  static std::shared_ptr<Decoded> Decode(const std::string &path) {
+    std::shared_ptr<ModelSource> source = std::make_shared<ModelSource>();
+    Model::Load(path, source.get());
+    return source;
+  }
+  static std::shared_ptr<Model> Create(std::shared_ptr<Decoded> decoded) {
+    return std::make_shared<Model>(std::move(*decoded));
+  }
+};
+
+// the sprite sheet creates its texture while loading, keep it on the main
+// thread
+template <> struct AssetTraits<SpriteSheet> {
+  using Decoded = std::string;
+  static std::shared_ptr<Decoded> Decode(const std::string &path) {
+    return std::make_shared<std::string>(path);
+  }
+  static std::shared_ptr<SpriteSheet> Create(std::shared_ptr<Decoded> path) {
+    return std::make_shared<SpriteSheet>(path->c_str());
+  }
+};
+
+// Result of an asynchronous load, ready once the main thread has finalized it
+// in AssetLoader::Update, never block on it from the main thread
+template <class T> class AssetHandle {
+public:
+  AssetHandle() = default;
+  AssetHandle(std::shared_future<std::shared_ptr<T>> future)
+      : future(future) {}
+
+  bool IsValid() const { return this->future.valid(); }
+
+  bool IsReady() const {
+    return this->future.valid() &&
+           this->future.wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+  }
+
+  // nullptr until the asset is ready, and for good when the load was dropped
+  // by AssetLoader::Shutdown
+  std::shared_ptr<T> Get() const {
+    return this->IsReady() ? this->future.get() : nullptr;
+  }
+
+private:
+  std::shared_future<std::shared_ptr<T>> future;
+};
+
+// Lazy-loaded asset manager. Loaded assets stay cached after the last
+// shared_ptr outside the cache is dropped and are only released when
+// AssetResidency needs the memory back, least recently used first.
+// getAsync is safe from any thread, the cache is split into shards that are
+// locked independently and each asset is only ever loaded once, concurrent
+// requests for an asset that is still loading wait for that load. get and
+// getFont create the asset on the calling thread, which makes GL objects and
+// fills the glyph cache, so they are main thread only like
+// AssetLoader::Update.
 template <class T> class AssetManager {
 private:
-  std::unordered_map<std::string, std::weak_ptr<T>> assets;
+  struct Entry {
+    // kept to tell hash collisions apart from hits
+    std::string path;
+    int variant;
+    // the cache reference, released on eviction
+    std::shared_ptr<T> asset;
+    AssetResidency::Id residencyId = 0;
+    // valid while the asset is being loaded
+    std::shared_future<std::shared_ptr<T>> loading;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+  };
+
+  Shard shards[ASSET_MANAGER_SHARDS];
+
   inline const static std::unique_ptr<AssetManager<T>> instance =
       std::make_unique<AssetManager<T>>();
 
+  inline static std::mutex lockedMutex;
   inline static std::vector<std::shared_ptr<T>> lockedAssets;
 
-public:
-  static std::shared_ptr<T> get(std::string path) {
-    auto asset = instance->assets.find(path);
-    if (asset != instance->assets.end() && !asset->second.expired()) {
-      SDL_Log("Cache Hit: %s", path.c_str());
-      return asset->second.lock();
-    } else {
-      SDL_Log("Cache Miss: %s", path.c_str());
-      std::shared_ptr<T> newAsset = std::make_shared<T>(path.c_str());
-      instance->assets[path] = newAsset;
-      return newAsset;
+  inline static std::atomic<bool> logging = false;
+
+  template <class... Args> static void log(const char *format, Args... args) {
+    if (logging) {
+      SDL_Log(format, args...);
+    }
+  }
+
+  static Shard &shardFor(uint64_t hash) {
+    return instance->shards[hash % ASSET_MANAGER_SHARDS];
+  }
+
+  static AssetHandle<T> ready(std::shared_ptr<T> asset) {
+    std::promise<std::shared_ptr<T>> promise;
+    promise.set_value(asset);
+    return AssetHandle<T>(promise.get_future().share());
+  }
+
+  // result of looking a key up with its shard locked
+  struct Lookup {
+    std::shared_ptr<T> asset;
+    std::shared_future<std::shared_ptr<T>> loading;
+    // set when this caller has to do the load
+    std::shared_ptr<std::promise<std::shared_ptr<T>>> promise;
+    // false when the key collided, the result is then not cached
+    bool cached = true;
+    AssetResidency::Id residencyId = 0;
+  };
+
+  static Lookup lookup(uint64_t hash, std::string_view path, int variant) {
+    Lookup result;
+    Shard &shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.entries.find(hash);
+    if (found != shard.entries.end()) {
+      Entry &entry = found->second;
+      if (entry.path != path || entry.variant != variant) {
+        // 64 bit collision, load it without caching
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Asset hash collision: %s and %.*s", entry.path.c_str(),
+                    (int)path.size(), path.data());
+        result.promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+        result.loading = result.promise->get_future().share();
+        result.cached = false;
+        return result;
+      }
+      result.asset = entry.asset;
+      if (result.asset) {
+        log("Cache Hit: %s", entry.path.c_str());
+        result.residencyId = entry.residencyId;
+        return result;
+      }
+      if (entry.loading.valid()) {
+        log("Cache Wait: %s", entry.path.c_str());
+        result.loading = entry.loading;
+        return result;
+      }
+    }
+
+    log("Cache Miss: %.*s", (int)path.size(), path.data());
+    Entry &entry = shard.entries[hash];
+    entry.path = path;
+    entry.variant = variant;
+    result.promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+    entry.loading = result.promise->get_future().share();
+    result.loading = entry.loading;
+    return result;
+  }
+
+  static void store(uint64_t hash, std::string_view path, int variant,
+                    std::shared_ptr<T> asset) {
+    // residency is never called with a shard locked, it locks shards itself
+    // when evicting
+    AssetResidency::Measure measure;
+    if constexpr (AssetGrows<T>::value) {
+      measure = [weak = std::weak_ptr<T>(asset)]() {
+        const std::shared_ptr<T> asset = weak.lock();
+        return asset ? GetAssetFootprint(*asset) : AssetFootprint();
+      };
+    }
+    const AssetResidency::Id id = AssetResidency::Add(
+        GetAssetFootprint(*asset),
+        [hash](std::shared_ptr<void> *released) {
+          return evict(hash, released);
+        },
+        std::move(measure));
+    {
+      Shard &shard = shardFor(hash);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto found = shard.entries.find(hash);
+      if (found != shard.entries.end() && found->second.path == path &&
+          found->second.variant == variant) {
+        found->second.asset = asset;
+        found->second.loading = {};
+        found->second.residencyId = id;
+      }
+    }
+  }
+
+  // drop an entry whose load produced no asset, the next request loads again
+  static void forget(uint64_t hash, std::string_view path, int variant) {
+    Shard &shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.entries.find(hash);
+    if (found != shard.entries.end() && !found->second.asset &&
+        found->second.path == path && found->second.variant == variant) {
+      shard.entries.erase(found);
     }
   }
+
+  // hand the cache reference to an asset nobody else holds to released, the
+  // caller destroys it outside every lock
+  static bool evict(uint64_t hash, std::shared_ptr<void> *released) {
+    Shard &shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.entries.find(hash);
+    if (found == shard.entries.end()) {
+      return true;
+    }
+    if (!found->second.asset) {
+      // still being stored, try again on the next trim
+      return !found->second.loading.valid();
+    }
+    if (found->second.asset.use_count() > 1) {
+      return false;
+    }
+    log("Cache Evict: %s", found->second.path.c_str());
+    *released = std::move(found->second.asset);
+    shard.entries.erase(found);
+    return true;
+  }
+
+  static std::shared_ptr<T> hit(const Lookup &result) {
+    AssetResidency::Touch(result.residencyId);
+    return result.asset;
+  }
+
+  // load on the calling thread, or wait for whoever is already loading it.
+  // main thread only
+  template <class Create>
+  static std::shared_ptr<T> acquire(uint64_t hash, std::string_view path,
+                                    int variant, Create create) {
+    SDL_assert(AssetLoader::IsFinalizeThread());
+    Lookup result = lookup(hash, path, variant);
+    if (result.asset) {
+      return hit(result);
+    }
+    if (!result.promise) {
+      return AssetLoader::Wait(result.loading);
+    }
+
+    std::shared_ptr<T> newAsset;
+    try {
+      newAsset = create();
+    } catch (...) {
+      // release the waiters, the next request tries again
+      if (result.cached) {
+        forget(hash, path, variant);
+      }
+      result.promise->set_exception(std::current_exception());
+      throw;
+    }
+    if (result.cached) {
+      store(hash, path, variant, newAsset);
+    }
+    result.promise->set_value(newAsset);
+    return newAsset;
+  }
+
+  // queue decode on a worker and create the asset on the thread running
+  // AssetLoader::Update
+  template <class Decode, class Create>
+  static AssetHandle<T> load(uint64_t hash, std::string_view path,
+                             int variant, Decode decode, Create create) {
+    Lookup result = lookup(hash, path, variant);
+    if (result.asset) {
+      return ready(hit(result));
+    }
+    if (!result.promise) {
+      return AssetHandle<T>(result.loading);
+    }
+
+    const bool cached = result.cached;
+    std::string id(path);
+    std::shared_ptr<std::promise<std::shared_ptr<T>>> promise =
+        result.promise;
+    AssetLoader::Enqueue(
+        [=]() {
+          auto decoded = decode();
+          return AssetLoader::Finalize([=]() {
+            std::shared_ptr<T> newAsset = create(decoded);
+            if (cached) {
+              store(hash, id, variant, newAsset);
+            }
+            promise->set_value(newAsset);
+          });
+        },
+        [=]() {
+          // dropped by AssetLoader::Shutdown, waiters get nullptr
+          if (cached) {
+            forget(hash, id, variant);
+          }
+          promise->set_value(nullptr);
+        });
+    return AssetHandle<T>(result.loading);
+  }
+
+public:
+  // load now on the main thread, use getAsync elsewhere
+  static std::shared_ptr<T> get(std::string_view path) {
+    return acquire(HashAssetPath(path), path, -1, [path]() {
+      return std::make_shared<T>(std::string(path).c_str());
+    });
+  }
+
+  // load in the background, see AssetLoader
+  static AssetHandle<T> getAsync(std::string_view path) {
+    std::string id(path);
+    return load(
+        HashAssetPath(path), path, -1,
+        [id]() { return AssetTraits<T>::Decode(id); },
+        [](auto decoded) { return AssetTraits<T>::Create(decoded); });
+  }
+
+  // sdf fonts are keyed apart from bitmap fonts of the same size
+  static int fontVariant(int size, FontMode mode) {
+    return mode == FontMode::SDF ? -size : size;
+  }
+
+  static AssetHandle<Font> getFontAsync(std::string_view path, int size,
+                                        FontMode mode = FontMode::Bitmap) {
+    TrackGlyphPages();
+    std::string id(path);
+    const int variant = fontVariant(size, mode);
+    return load(
+        HashAssetVariant(HashAssetPath(path), variant), path, variant,
+        [id, size, mode]() {
+          std::shared_ptr<FontData> data = std::make_shared<FontData>();
+          Font::Decode(id.c_str(), size, data.get(), mode);
+          return data;
+        },
+        [](std::shared_ptr<FontData> data) {
+          return std::make_shared<Font>(std::move(*data));
+        });
+  }
+
+  // log every cache hit and miss, off by default
+  static void setLogging(bool enabled) { logging = enabled; }
+
   // temporarily lock all assets to prevent them from being unloaded
   static void lockAll() {
-    for (auto &asset : instance->assets) {
-      if (!asset.second.expired()) {
-        instance->lockedAssets.push_back(asset.second.lock());
+    std::lock_guard<std::mutex> locked(lockedMutex);
+    for (auto &shard : instance->shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (auto &entry : shard.entries) {
+        if (entry.second.asset) {
+          lockedAssets.push_back(entry.second.asset);
+        }
       }
     }
   }
   // unlock all assets to allow them to be unloaded
-  static void unlockAll() { instance->lockedAssets.clear(); }
-
-  static std::shared_ptr<Font> getFont(std::string path, int size) {
-    const auto id = path + "?" + std::to_string(size);
-    auto asset = instance->assets.find(id);
-    if (asset != instance->assets.end() && !asset->second.expired()) {
-      SDL_Log("Cache Hit: %s", id.c_str());
-      return asset->second.lock();
-    } else {
-      SDL_Log("Cache Miss: %s", id.c_str());
-      std::shared_ptr<T> newAsset = std::make_shared<Font>(path.c_str(), size);
-      instance->assets[id] = newAsset;
-      return newAsset;
-    }
-  }
-};
\ No newline at end of file
+  static void unlockAll() {
+    std::lock_guard<std::mutex> locked(lockedMutex);
+    lockedAssets.clear();
+  }
+
+  // load now on the main thread, use getFontAsync elsewhere
+  static std::shared_ptr<Font> getFont(std::string_view path, int size,
+                                       FontMode mode = FontMode::Bitmap) {
+    TrackGlyphPages();
+    const int variant = fontVariant(size, mode);
+    return acquire(HashAssetVariant(HashAssetPath(path), variant), path,
+                   variant, [path, size, mode]() {
+                     return std::make_shared<Font>(std::string(path).c_str(),
+                                                   size, mode);
+                   });
+  }
+};
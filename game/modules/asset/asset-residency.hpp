@@ -0,0 +1,160 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// default memory budget for resident assets, the web build only has a 64MB
+// heap to share with everything else
+#ifdef EMSCRIPTEN
+#define ASSET_RESIDENCY_DEFAULT_BUDGET (24u * 1024u * 1024u)
+#else
+#define ASSET_RESIDENCY_DEFAULT_BUDGET (512u * 1024u * 1024u)
+#endif
+
+struct AssetFootprint {
+  size_t cpuBytes = 0;
+  size_t gpuBytes = 0;
+
+  size_t Total() const { return this->cpuBytes + this->gpuBytes; }
+};
+
+template <class T> AssetFootprint GetAssetFootprint(const T &asset) {
+  return {asset.GetCPUBytes(), asset.GetGPUBytes()};
+}
+
+// assets whose footprint keeps growing after they are stored, only these are
+// re-measured on Trim
+template <class T> struct AssetGrows : std::false_type {};
+
+// Tracks the footprint of every cached asset across all AssetManagers in
+// least recently used order. The caches keep a strong reference to their
+// assets so assets nobody uses stay around for quick revival, once the total
+// goes over budget the least recently used of those are evicted. Add and
+// Touch are safe from any thread, Trim runs on the frame loop.
+class AssetResidency {
+public:
+  using Id = uint64_t;
+  // the current footprint of an asset that grows after it is added (fonts
+  // rasterize glyphs as text is drawn), called by Trim on the frame loop
+  using Measure = std::function<AssetFootprint()>;
+  // drop the cache reference if the cache holds the only one and hand it to
+  // released, returns whether the asset was released. called with no cache
+  // locks held
+  using Evict = std::function<bool(std::shared_ptr<void> *released)>;
+
+  // account for a new asset, nothing is evicted until the next Trim. measure
+  // may be empty for assets that do not grow
+  static Id Add(AssetFootprint footprint, Evict evict, Measure measure = {}) {
+    std::lock_guard<std::mutex> lock(instance->mutex);
+    const Id id = ++instance->nextId;
+    if (measure) {
+      instance->growing.push_back(id);
+    }
+    instance->lru.push_front(
+        {id, footprint, std::move(measure), std::move(evict)});
+    instance->records[id] = instance->lru.begin();
+    instance->usage.cpuBytes += footprint.cpuBytes;
+    instance->usage.gpuBytes += footprint.gpuBytes;
+    return id;
+  }
+
+  // mark an asset as just used
+  static void Touch(Id id) {
+    std::lock_guard<std::mutex> lock(instance->mutex);
+    auto record = instance->records.find(id);
+    if (record != instance->records.end()) {
+      instance->lru.splice(instance->lru.begin(), instance->lru,
+                           record->second);
+    }
+  }
+
+  // re-measure the assets that grow, then evict least recently used
+  // unreferenced assets until under budget. assets that are still referenced
+  // are skipped so usage can stay above budget. frame loop only, where fonts
+  // rasterize their glyphs and evicted assets may queue GL work
+  static void Trim() {
+    std::vector<std::shared_ptr<void>> released;
+    {
+      std::lock_guard<std::mutex> lock(instance->mutex);
+      for (const Id id : instance->growing) {
+        instance->remeasure(*instance->records[id]);
+      }
+
+      auto it = instance->lru.end();
+      while (instance->usage.Total() > instance->budget &&
+             it != instance->lru.begin()) {
+        --it;
+        std::shared_ptr<void> asset;
+        if (!it->evict(&asset)) {
+          continue;
+        }
+        SDL_Log("Evicted asset: %zu bytes", it->footprint.Total());
+        released.push_back(std::move(asset));
+        instance->usage.cpuBytes -= it->footprint.cpuBytes;
+        instance->usage.gpuBytes -= it->footprint.gpuBytes;
+        if (it->measure) {
+          std::erase(instance->growing, it->id);
+        }
+        instance->records.erase(it->id);
+        it = instance->lru.erase(it);
+      }
+    }
+    // the evicted assets are destroyed here, outside the lock so Touch and
+    // Add on other threads are not held up
+    released.clear();
+  }
+
+  // takes effect on the next Trim
+  static void SetBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(instance->mutex);
+    instance->budget = bytes;
+  }
+
+  static size_t GetBudget() {
+    std::lock_guard<std::mutex> lock(instance->mutex);
+    return instance->budget;
+  }
+
+  static AssetFootprint GetUsage() {
+    std::lock_guard<std::mutex> lock(instance->mutex);
+    return instance->usage;
+  }
+
+private:
+  struct Record {
+    Id id;
+    // as of Add or the last measure
+    AssetFootprint footprint;
+    // empty unless the asset grows
+    Measure measure;
+    Evict evict;
+  };
+
+  // with the mutex held
+  void remeasure(Record &record) {
+    const AssetFootprint footprint = record.measure();
+    this->usage.cpuBytes += footprint.cpuBytes - record.footprint.cpuBytes;
+    this->usage.gpuBytes += footprint.gpuBytes - record.footprint.gpuBytes;
+    record.footprint = footprint;
+  }
+
+  inline const static std::unique_ptr<AssetResidency> instance =
+      std::make_unique<AssetResidency>();
+
+  std::mutex mutex;
+  // most recently used first
+  std::list<Record> lru;
+  std::unordered_map<Id, std::list<Record>::iterator> records;
+  // records with a measure, few compared to all records
+  std::vector<Id> growing;
+  AssetFootprint usage;
+  size_t budget = ASSET_RESIDENCY_DEFAULT_BUDGET;
+  Id nextId = 0;
+};
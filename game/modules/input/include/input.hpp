@@ -38,7 +38,6 @@ private:
   bool use_text_input = false;
 
   const char *text_input_buffer = "";
-  float *input_volume_ref = nullptr;
 
 public:
   static void Update(const uint8_t *key_state, const int num_keys);
@@ -61,9 +60,8 @@ public:
 
   static void SetTextInputBuffer(const char *text);
 
+  // smoothed microphone level, see MicLevel. wait-free
   static float GetInputVolume();
 
-  static void SetInputVolumeRef(float *volume);
-
   static bool IsTextInputActive();
 };
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// level frames the ring holds, a power of two. at MIC_LEVEL_BLOCK samples per
+// frame and 44.1kHz this is ~190ms of capture
+#define MIC_LEVEL_RING_SIZE 64
+// samples measured per level frame, a capture buffer is split into blocks so
+// the envelope follows the voice inside one callback
+#define MIC_LEVEL_BLOCK 128
+
+// default envelope time constants in seconds, a fast attack so the player
+// reacts at once and a slower release so it does not jitter between syllables
+#define MIC_LEVEL_ATTACK 0.005f
+#define MIC_LEVEL_RELEASE 0.12f
+
+// level of one block of capture samples
+struct MicLevelFrame {
+  float peak;
+  float rms;
+  // length of the block
+  float seconds;
+};
+
+enum class MicDetector {
+  // loudest sample, what the game was tuned for
+  Peak,
+  // root mean square, steadier but lower for the same voice
+  Rms,
+};
+
+struct MicLevelSettings {
+  MicDetector detector = MicDetector::Peak;
+  float attack = MIC_LEVEL_ATTACK;
+  float release = MIC_LEVEL_RELEASE;
+  // applied before smoothing, for quiet microphones
+  float gain = 1.0f;
+};
+
+// microphone level pipeline. the SDL audio thread measures each capture
+// buffer and pushes level frames into a single producer single consumer ring,
+// the frame loop drains the ring through an attack/release envelope and
+// publishes the result, which any thread reads without waiting. shared by the
+// host and the hot reloaded game through SharedData
+class MicLevel {
+public:
+  // the pipeline levels are read from, the game attaches to the host's
+  static MicLevel *Get();
+  static void Attach(MicLevel *level);
+
+  // producer side, never blocks or allocates. frames are dropped while the
+  // ring is full, the consumer is stalled then anyway
+  static void SetSampleRate(int sampleRate);
+  static void PushSamples(const float *samples, size_t count);
+  static void PushFrame(const MicLevelFrame &frame);
+
+  // peak and rms of a block of samples, vectorized with simd.hpp
+  static MicLevelFrame Measure(const float *samples, size_t count);
+
+  // consumer side, call once per frame from the frame loop
+  static void Update();
+  static void SetSettings(const MicLevelSettings &settings);
+
+  // the smoothed level, wait-free from any thread
+  static float GetLevel();
+
+private:
+  bool pop(MicLevelFrame *out);
+
+  MicLevelFrame frames[MIC_LEVEL_RING_SIZE];
+  // head is only written by the producer and tail by the consumer, each on
+  // its own cache line so they do not bounce between cores
+  alignas(64) std::atomic<uint32_t> head = 0;
+  alignas(64) std::atomic<uint32_t> tail = 0;
+
+  // producer only
+  int sampleRate = 44100;
+
+  // consumer only
+  MicLevelSettings settings;
+  float envelope = 0.0f;
+
+  std::atomic<float> level = 0.0f;
+  static_assert(std::atomic<float>::is_always_lock_free,
+                "the level must be readable without a lock");
+};
@@ -1,4 +1,5 @@
 #include "input.hpp"
+#include "mic-level.hpp"
 
 static std::unique_ptr<InputManager> instance =
     std::make_unique<InputManager>();
@@ -102,16 +103,7 @@ void InputManager::SetTextInputBuffer(const char *text) {
   instance->text_input_buffer = text;
 }
 
-float InputManager::GetInputVolume() {
-  std::lock_guard<std::mutex> lock(instance->mtx); // thread safety
-  return instance->input_volume_ref == nullptr ? 0.0f
-                                               : *instance->input_volume_ref;
-}
-
-void InputManager::SetInputVolumeRef(float *volume) {
-  std::lock_guard<std::mutex> lock(instance->mtx); // thread safety
-  instance->input_volume_ref = volume;
-}
+float InputManager::GetInputVolume() { return MicLevel::GetLevel(); }
 
 bool InputManager::IsTextInputActive() {
   std::lock_guard<std::mutex> lock(instance->mtx); // thread safety
@@ -0,0 +1,128 @@
+#include "mic-level.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <simd.hpp>
+
+static_assert((MIC_LEVEL_RING_SIZE & (MIC_LEVEL_RING_SIZE - 1)) == 0,
+              "MIC_LEVEL_RING_SIZE must be a power of two");
+
+static MicLevel *instance = nullptr;
+
+MicLevel *MicLevel::Get() {
+  if (instance == nullptr) {
+    // never freed, the audio thread may still push while we shut down
+    instance = new MicLevel();
+  }
+  return instance;
+}
+
+void MicLevel::Attach(MicLevel *level) {
+  if (level != nullptr) {
+    instance = level;
+  }
+}
+
+void MicLevel::SetSampleRate(int sampleRate) {
+  if (sampleRate > 0) {
+    MicLevel::Get()->sampleRate = sampleRate;
+  }
+}
+
+void MicLevel::PushSamples(const float *samples, size_t count) {
+  MicLevel *mic = MicLevel::Get();
+  for (size_t i = 0; i < count; i += MIC_LEVEL_BLOCK) {
+    const size_t blockCount = std::min<size_t>(MIC_LEVEL_BLOCK, count - i);
+    MicLevelFrame frame = MicLevel::Measure(samples + i, blockCount);
+    frame.seconds = (float)blockCount / mic->sampleRate;
+    MicLevel::PushFrame(frame);
+  }
+}
+
+void MicLevel::PushFrame(const MicLevelFrame &frame) {
+  MicLevel *mic = MicLevel::Get();
+  const uint32_t head = mic->head.load(std::memory_order_relaxed);
+  const uint32_t tail = mic->tail.load(std::memory_order_acquire);
+  if (head - tail == MIC_LEVEL_RING_SIZE) {
+    return;
+  }
+  mic->frames[head & (MIC_LEVEL_RING_SIZE - 1)] = frame;
+  mic->head.store(head + 1, std::memory_order_release);
+}
+
+bool MicLevel::pop(MicLevelFrame *out) {
+  const uint32_t tail = this->tail.load(std::memory_order_relaxed);
+  const uint32_t head = this->head.load(std::memory_order_acquire);
+  if (tail == head) {
+    return false;
+  }
+  *out = this->frames[tail & (MIC_LEVEL_RING_SIZE - 1)];
+  this->tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+MicLevelFrame MicLevel::Measure(const float *samples, size_t count) {
+  MicLevelFrame frame = {0.0f, 0.0f, 0.0f};
+  if (count == 0) {
+    return frame;
+  }
+
+  simd::float4 peak4 = simd::Splat(0.0f);
+  simd::float4 sum4 = simd::Splat(0.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const simd::float4 v = simd::Load(samples + i);
+    peak4 = simd::Max(peak4, simd::Abs(v));
+    sum4 = simd::Add(sum4, simd::Mul(v, v));
+  }
+
+  float lanes[4];
+  simd::Store(lanes, peak4);
+  float peak = std::max(std::max(lanes[0], lanes[1]),
+                        std::max(lanes[2], lanes[3]));
+  simd::Store(lanes, sum4);
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+  // the samples that do not fill a vector
+  for (; i < count; i++) {
+    peak = std::max(peak, std::abs(samples[i]));
+    sum += samples[i] * samples[i];
+  }
+
+  frame.peak = peak;
+  frame.rms = std::sqrt(sum / count);
+  return frame;
+}
+
+void MicLevel::Update() {
+  MicLevel *mic = MicLevel::Get();
+  const MicLevelSettings &settings = mic->settings;
+
+  MicLevelFrame frame;
+  bool updated = false;
+  while (mic->pop(&frame)) {
+    const float target =
+        (settings.detector == MicDetector::Rms ? frame.rms : frame.peak) *
+        settings.gain;
+    // one pole envelope, the time constant depends on the direction
+    const float timeConstant =
+        target > mic->envelope ? settings.attack : settings.release;
+    const float alpha =
+        timeConstant > 0.0f ? 1.0f - std::exp(-frame.seconds / timeConstant)
+                            : 1.0f;
+    mic->envelope += (target - mic->envelope) * alpha;
+    updated = true;
+  }
+
+  if (updated) {
+    mic->level.store(mic->envelope, std::memory_order_relaxed);
+  }
+}
+
+void MicLevel::SetSettings(const MicLevelSettings &settings) {
+  MicLevel::Get()->settings = settings;
+}
+
+float MicLevel::GetLevel() {
+  return MicLevel::Get()->level.load(std::memory_order_relaxed);
+}
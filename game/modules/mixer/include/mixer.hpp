@@ -1,7 +1,9 @@
 #pragma once
 #include <SDL.h>
 #include <SDL_mixer.h>
+#include <cstdint>
 #include <memory>
+#include <span>
 
 #define MAX_SOUND_CHANNELS 8
 
@@ -19,21 +21,38 @@ private:
 class Music {
 public:
   Music(const char *path);
+  // music is streamed while playing, data has to outlive it
+  Music(std::span<const uint8_t> data);
   ~Music();
 
   void play_on_loop();
 
+  // music is streamed from disk, only the decoder state is resident
+  size_t GetCPUBytes() const { return sizeof(Music); }
+  size_t GetGPUBytes() const { return 0; }
+
 private:
   Mix_Music *sdl_music;
+  // keeps the streamed file data alive
+  std::shared_ptr<const void> owner;
 };
 
 class SoundEffect {
 public:
   SoundEffect(const char *path);
+  // the sample is decoded on construction, data can be released afterwards
+  SoundEffect(std::span<const uint8_t> data);
   ~SoundEffect();
 
   void play();
 
+  // the whole sample is decoded into memory on load
+  size_t GetCPUBytes() const {
+    return sizeof(SoundEffect) +
+           (this->sdl_chunk != nullptr ? this->sdl_chunk->alen : 0);
+  }
+  size_t GetGPUBytes() const { return 0; }
+
 private:
   Mix_Chunk *sdl_chunk;
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "mixer.hpp"
+#include <archive.hpp>
 
 Mixer::Mixer() {
   // frequency of 44100 (CD quality), the default format, 2 channels (stereo)
@@ -29,7 +30,24 @@ void Mixer::ToggleMute() {
 }
 
 Music::Music(const char *path) {
-  this->sdl_music = Mix_LoadMUS(path);
+  AssetBlob blob;
+  if (AssetArchive::Open(path, &blob)) {
+    this->sdl_music = Mix_LoadMUS_RW(
+        SDL_RWFromConstMem(blob.data.data(), blob.data.size()), 1);
+    this->owner = blob.owner;
+  } else {
+    this->sdl_music = nullptr;
+  }
+
+  if (this->sdl_music == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to load music: %s\n",
+                 Mix_GetError());
+  }
+}
+
+Music::Music(std::span<const uint8_t> data) {
+  this->sdl_music =
+      Mix_LoadMUS_RW(SDL_RWFromConstMem(data.data(), data.size()), 1);
 
   if (this->sdl_music == nullptr) {
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to load music: %s\n",
@@ -53,7 +71,23 @@ void Music::play_on_loop() {
 
 SoundEffect::SoundEffect(const char *path) {
   // loadWAV returns a Mix_Chunk pointer, it loads other formats too
-  this->sdl_chunk = Mix_LoadWAV(path);
+  AssetBlob blob;
+  if (AssetArchive::Open(path, &blob)) {
+    this->sdl_chunk = Mix_LoadWAV_RW(
+        SDL_RWFromConstMem(blob.data.data(), blob.data.size()), 1);
+  } else {
+    this->sdl_chunk = nullptr;
+  }
+
+  if (this->sdl_chunk == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to load sound effect: %s\n",
+                 Mix_GetError());
+  }
+}
+
+SoundEffect::SoundEffect(std::span<const uint8_t> data) {
+  this->sdl_chunk =
+      Mix_LoadWAV_RW(SDL_RWFromConstMem(data.data(), data.size()), 1);
 
   if (this->sdl_chunk == nullptr) {
     SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to load sound effect: %s\n",
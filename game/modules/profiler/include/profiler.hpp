@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// zone events each thread keeps, the oldest are overwritten. power of two
+#define PROFILER_RING_SIZE 8192
+
+// frames kept for the frame graph
+#define PROFILER_FRAME_HISTORY 240
+
+struct ProfileFrame {
+  // steady clock nanoseconds
+  uint64_t start;
+  float cpuMs;
+  // 0 until the frame's GPU timer query resolves, or without timer queries
+  float gpuMs;
+};
+
+#ifdef PROFILER_ENABLED
+
+struct ProfileEvent {
+  uint64_t start;
+  uint64_t end;
+  uint32_t zone;
+};
+
+// events recorded by one thread, only that thread writes so recording never
+// locks. readers copy and drop whatever was overwritten meanwhile
+struct ProfileRing {
+  std::atomic<uint64_t> head = 0;
+  uint32_t threadId = 0;
+  // the thread exited, the next new thread takes the ring over
+  std::atomic<bool> released = false;
+  ProfileEvent events[PROFILER_RING_SIZE];
+};
+
+// scoped zone profiler, see PROFILE_ZONE. one instance is shared by the host
+// and the hot reloaded game through SharedData
+class Profiler {
+public:
+  Profiler();
+
+  // the profiler recording goes to, the game attaches to the host's so both
+  // sides of a hot reload end up in one trace
+  static Profiler *Get();
+  static void Attach(Profiler *profiler);
+
+  // id for a zone name, the name is copied so zones from an unloaded library
+  // stay readable
+  static uint32_t RegisterZone(const char *name);
+
+  // steady clock nanoseconds
+  static uint64_t Now();
+
+  static void Record(uint32_t zone, uint64_t start, uint64_t end);
+
+  // frame boundaries, called by the app around each update
+  static void BeginFrame();
+  static void EndFrame();
+  static uint64_t GetFrameNumber();
+
+  // GPU time for an earlier frame, timer results arrive a few frames late
+  static void SetGpuTime(uint64_t frame, float ms);
+
+  // the last frames, oldest first. returns the number written
+  static size_t GetFrames(ProfileFrame *out, size_t count);
+
+  // every zone still in the rings as chrome://tracing / Perfetto json
+  static bool WriteChromeTrace(const char *path);
+
+private:
+  ProfileRing *addRing();
+
+  uint64_t epoch;
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ProfileRing>> rings;
+  std::vector<std::string> zoneNames;
+  std::unordered_map<std::string, uint32_t> zoneIds;
+
+  // written by the thread running the frame loop, gpu times arrive from the
+  // render thread so the frame history is guarded
+  std::mutex frameMutex;
+  uint64_t frameNumber = 0;
+  uint64_t frameStart = 0;
+  uint32_t frameZone = 0;
+  ProfileFrame frames[PROFILER_FRAME_HISTORY] = {};
+};
+
+class ProfileZone {
+public:
+  ProfileZone(uint32_t zone) : zone(zone), start(Profiler::Now()) {}
+  ~ProfileZone() { Profiler::Record(this->zone, this->start, Profiler::Now()); }
+
+private:
+  uint32_t zone;
+  uint64_t start;
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+// times the rest of the enclosing scope
+#define PROFILE_ZONE(name)                                                     \
+  static const uint32_t PROFILER_CONCAT(profileZoneId, __LINE__) =            \
+      Profiler::RegisterZone(name);                                            \
+  ProfileZone PROFILER_CONCAT(profileZone, __LINE__)(                          \
+      PROFILER_CONCAT(profileZoneId, __LINE__))
+
+#else
+
+// profiling is compiled out, every call is an empty inline
+class Profiler {
+public:
+  static Profiler *Get() { return nullptr; }
+  static void Attach(Profiler *profiler) { (void)profiler; }
+  static void BeginFrame() {}
+  static void EndFrame() {}
+  static uint64_t GetFrameNumber() { return 0; }
+  static void SetGpuTime(uint64_t frame, float ms) {
+    (void)frame;
+    (void)ms;
+  }
+  static size_t GetFrames(ProfileFrame *out, size_t count) {
+    (void)out;
+    (void)count;
+    return 0;
+  }
+  static bool WriteChromeTrace(const char *path) {
+    (void)path;
+    return false;
+  }
+};
+
+#define PROFILE_ZONE(name)
+
+#endif
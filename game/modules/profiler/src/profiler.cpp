@@ -0,0 +1,217 @@
+#include "profiler.hpp"
+
+#ifdef PROFILER_ENABLED
+
+#include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static Profiler *instance = nullptr;
+
+// this thread's ring and the profiler it belongs to, the ring is handed back
+// when the thread exits so worker pools restarted on every hot reload do not
+// keep adding rings
+struct ThreadRing {
+  ProfileRing *ring = nullptr;
+  Profiler *owner = nullptr;
+
+  ~ThreadRing() {
+    if (this->ring != nullptr) {
+      this->ring->released = true;
+    }
+  }
+};
+static thread_local ThreadRing threadRing;
+
+Profiler::Profiler() {
+  this->epoch = Profiler::Now();
+  this->frameZone = 0;
+  this->zoneNames.push_back("Frame");
+  this->zoneIds["Frame"] = this->frameZone;
+}
+
+Profiler *Profiler::Get() {
+  if (instance == nullptr) {
+    // never freed, zones may still be recorded during static destruction
+    instance = new Profiler();
+  }
+  return instance;
+}
+
+void Profiler::Attach(Profiler *profiler) {
+  if (profiler != nullptr) {
+    instance = profiler;
+  }
+}
+
+uint32_t Profiler::RegisterZone(const char *name) {
+  Profiler *profiler = Profiler::Get();
+  std::lock_guard<std::mutex> lock(profiler->mutex);
+  const auto found = profiler->zoneIds.find(name);
+  if (found != profiler->zoneIds.end()) {
+    return found->second;
+  }
+  const uint32_t id = (uint32_t)profiler->zoneNames.size();
+  profiler->zoneNames.push_back(name);
+  profiler->zoneIds[name] = id;
+  return id;
+}
+
+uint64_t Profiler::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+ProfileRing *Profiler::addRing() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (const auto &ring : this->rings) {
+    if (ring->released) {
+      ring->released = false;
+      return ring.get();
+    }
+  }
+  this->rings.push_back(std::make_unique<ProfileRing>());
+  ProfileRing *ring = this->rings.back().get();
+  ring->threadId = (uint32_t)this->rings.size();
+  return ring;
+}
+
+void Profiler::Record(uint32_t zone, uint64_t start, uint64_t end) {
+  Profiler *profiler = Profiler::Get();
+  if (threadRing.owner != profiler) {
+    // first zone on this thread, or the game attached to the host's profiler
+    if (threadRing.ring != nullptr) {
+      threadRing.ring->released = true;
+    }
+    threadRing.ring = profiler->addRing();
+    threadRing.owner = profiler;
+  }
+
+  ProfileRing *ring = threadRing.ring;
+  const uint64_t head = ring->head.load(std::memory_order_relaxed);
+  ring->events[head & (PROFILER_RING_SIZE - 1)] = {start, end, zone};
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::BeginFrame() { Profiler::Get()->frameStart = Profiler::Now(); }
+
+void Profiler::EndFrame() {
+  Profiler *profiler = Profiler::Get();
+  const uint64_t end = Profiler::Now();
+  Profiler::Record(profiler->frameZone, profiler->frameStart, end);
+
+  std::lock_guard<std::mutex> lock(profiler->frameMutex);
+  ProfileFrame &frame =
+      profiler->frames[profiler->frameNumber % PROFILER_FRAME_HISTORY];
+  frame.start = profiler->frameStart;
+  frame.cpuMs = (end - profiler->frameStart) / 1e6f;
+  frame.gpuMs = 0.0f;
+  profiler->frameNumber++;
+}
+
+uint64_t Profiler::GetFrameNumber() { return Profiler::Get()->frameNumber; }
+
+void Profiler::SetGpuTime(uint64_t frame, float ms) {
+  Profiler *profiler = Profiler::Get();
+  std::lock_guard<std::mutex> lock(profiler->frameMutex);
+  // results older than the history are dropped
+  if (frame >= profiler->frameNumber ||
+      profiler->frameNumber - frame > PROFILER_FRAME_HISTORY) {
+    return;
+  }
+  profiler->frames[frame % PROFILER_FRAME_HISTORY].gpuMs = ms;
+}
+
+size_t Profiler::GetFrames(ProfileFrame *out, size_t count) {
+  Profiler *profiler = Profiler::Get();
+  std::lock_guard<std::mutex> lock(profiler->frameMutex);
+  count = std::min({count, (size_t)PROFILER_FRAME_HISTORY,
+                    (size_t)profiler->frameNumber});
+  const uint64_t first = profiler->frameNumber - count;
+  for (size_t i = 0; i < count; i++) {
+    out[i] = profiler->frames[(first + i) % PROFILER_FRAME_HISTORY];
+  }
+  return count;
+}
+
+// zone names are plain identifiers, only quotes and backslashes need escaping
+static void writeJsonString(FILE *file, const std::string &value) {
+  fputc('"', file);
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      fputc('\\', file);
+    }
+    fputc(c, file);
+  }
+  fputc('"', file);
+}
+
+bool Profiler::WriteChromeTrace(const char *path) {
+  Profiler *profiler = Profiler::Get();
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "Profiler: could not write %s", path);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(profiler->mutex);
+  std::vector<ProfileEvent> events;
+  bool first = true;
+  fputs("{\"traceEvents\":[\n", file);
+  for (const auto &ring : profiler->rings) {
+    // copy what is in the ring, then drop anything the owning thread
+    // overwrote while we were copying
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t begin =
+        head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+    events.clear();
+    for (uint64_t i = begin; i < head; i++) {
+      events.push_back(ring->events[i & (PROFILER_RING_SIZE - 1)]);
+    }
+    // the owning thread may be writing the slot of newHead, which holds
+    // event newHead - PROFILER_RING_SIZE, before it publishes newHead + 1
+    const uint64_t newHead = ring->head.load(std::memory_order_acquire);
+    const uint64_t valid = newHead >= PROFILER_RING_SIZE
+                               ? newHead - PROFILER_RING_SIZE + 1
+                               : 0;
+    const size_t skip =
+        (size_t)std::min<uint64_t>(events.size(), valid > begin ? valid - begin
+                                                                : 0);
+
+    for (size_t i = skip; i < events.size(); i++) {
+      const ProfileEvent &event = events[i];
+      fputs(first ? "{\"name\":" : ",\n{\"name\":", file);
+      first = false;
+      writeJsonString(file, profiler->zoneNames[event.zone]);
+      fprintf(file,
+              ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+              ring->threadId, (event.start - profiler->epoch) / 1000.0,
+              (event.end - event.start) / 1000.0);
+    }
+  }
+
+  // gpu frame times as a counter track
+  ProfileFrame frames[PROFILER_FRAME_HISTORY];
+  const size_t count = Profiler::GetFrames(frames, PROFILER_FRAME_HISTORY);
+  for (size_t i = 0; i < count; i++) {
+    if (frames[i].gpuMs <= 0.0f) {
+      continue;
+    }
+    fprintf(file,
+            "%s{\"name\":\"GPU ms\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,"
+            "\"args\":{\"gpu\":%.3f}}",
+            first ? "" : ",\n", (frames[i].start - profiler->epoch) / 1000.0,
+            frames[i].gpuMs);
+    first = false;
+  }
+  fputs("\n]}\n", file);
+  fclose(file);
+
+  SDL_Log("Profiler: wrote %s", path);
+  return true;
+}
+
+#endif
@@ -2,7 +2,30 @@
 
 #define TEXT_BUFFER_SIZE 256
 
+class MicLevel;
+class Profiler;
+class RenderStats;
+class RenderThread;
+
 struct SharedData {
   char text_input_buffer[TEXT_BUFFER_SIZE];
-  float *input_volume;
-};
\ No newline at end of file
+  // the host's microphone level, fed by its audio thread
+  MicLevel *mic_level;
+  // GL loader for the host's context, the game loads its own glad with it
+  void *(*gl_get_proc_address)(const char *name);
+  // drawable size, there is no SDL window to ask when running headless
+  int window_width;
+  int window_height;
+  // seconds the game advances every frame, 0 follows the wall clock
+  float fixed_dt;
+  // simulation ticks per second, 0 uses the game's default
+  int tick_rate;
+  // start rounds without waiting for enter, for unattended replays
+  bool autoplay;
+  // the host's profiler, null when profiling is compiled out
+  Profiler *profiler;
+  // the host's render counters, the host ends their frames in Present
+  RenderStats *render_stats;
+  // the host's render thread, GL calls from the game are recorded into it
+  RenderThread *render_thread;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "model.hpp"
+
+#include <cstdint>
+#include <string>
+
+// binary model cache written by the model baker, layout on disk:
+//   BakedModelHeader
+//   MaterialBlock[materialCount]
+//   BakedMesh[meshCount]
+//   vertex and index data, each block aligned to BAKED_MODEL_ALIGNMENT
+// everything is little endian and already in the layout GL expects. bakes
+// are kept up to date by the build (bake_models re-bakes a model whenever its
+// source changes), the game never looks at the source to check
+#define BAKED_MODEL_MAGIC 0x4D425454 // "TTBM"
+// bump whenever the layout or any of the vertex formats change
+#define BAKED_MODEL_VERSION 3
+#define BAKED_MODEL_ALIGNMENT 16
+#define BAKED_MODEL_EXTENSION "tbm"
+
+struct BakedModelHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t materialCount;
+  uint32_t meshCount;
+  uint64_t fileSize;
+};
+
+struct BakedMesh {
+  // offsets from the start of the file
+  uint64_t vertexOffset;
+  uint64_t indexOffset;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  uint32_t indexType;
+  uint32_t vertexFormat;
+  uint32_t material;
+  uint32_t padding[3];
+  float model[16];
+};
+
+// path of the baked file that sits next to a source model
+std::string GetBakedModelPath(const std::string &sourcePath);
+
+// write data to path
+bool WriteBakedModel(const ModelData &data, VertexFormat format,
+                     const std::string &path);
+
+// returns the header if the blob is a complete baked model of the current
+// version, nullptr otherwise, offsets and counts are bounds checked
+const BakedModelHeader *ValidateBakedModel(const uint8_t *data, size_t size);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ETC2 RGBA8 (EAC alpha + ETC2 color), 16 bytes per 4x4 block, the format
+// every GLES3 device supports
+#define ETC2_BLOCK_SIZE 16
+#define ETC2_BLOCK_DIM 4
+
+// bytes needed for an ETC2 RGBA8 image of the given size
+size_t GetETC2ImageSize(int w, int h);
+
+// decode one block into 4x4 RGBA8 pixels, row major
+void DecodeETC2Block(const uint8_t *block, uint8_t *pixels);
+
+// encode 4x4 RGBA8 pixels, row major. uses the ETC1 compatible individual and
+// differential modes only, which is enough for offline cooking
+void EncodeETC2Block(const uint8_t *pixels, uint8_t *block);
+
+// decode a whole image, out holds w * h RGBA8 pixels
+void DecodeETC2Image(const uint8_t *blocks, int w, int h, uint8_t *out);
+
+// encode a whole image, edge blocks are padded by repeating the last row /
+// column, out holds GetETC2ImageSize(w, h) bytes
+void EncodeETC2Image(const uint8_t *pixels, int w, int h, uint8_t *out);
@@ -6,13 +6,37 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "glyph-cache.hpp"
 #include "sprite-batch.hpp"
 
+#include <archive.hpp>
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <unordered_map>
+#include <vector>
+
+// codepoint drawn for invalid UTF-8
+#define UNICODE_REPLACEMENT 0xFFFD
+
+// codepoints below this are cached in a flat table indexed by codepoint, the
+// rest go through a hash map
+#define FONT_DENSE_GLYPHS 256
 
-#define ASCII_OFFSET 32
-#define ASCII_MAX 126
-#define ASCII_EXTENDED_MAX 255
+// pixel size distance field glyphs are rasterized at, any size is drawn from
+// it by scaling
+#define FONT_SDF_SIZE 48
+// distance in pixels covered by the field on each side of the outline
+#define FONT_SDF_SPREAD 8
+
+enum class FontMode {
+  // coverage glyphs, crisp at the loaded size only
+  Bitmap,
+  // signed distance field glyphs, one atlas for every size and outlines
+  SDF,
+};
 
 typedef unsigned int uint;
 
@@ -21,26 +45,112 @@ struct Glyph {
   glm::ivec2 size;
   glm::ivec2 texCoords;
   glm::vec2 advance;
+  // glyph cache page, 0 for glyphs without pixels (e.g. space)
+  GLuint texture;
+};
+
+// consecutive glyph quads in a vertex list that sample the same page
+struct TextRun {
+  GLuint texture;
+  uint8_t flags;
+  size_t first;
+  size_t count;
+};
+
+// freetype face and the file it reads from, glyphs are rasterized from it
+// lazily so both stay alive as long as the font
+struct FontFace {
+  FT_Library library = nullptr;
+  FT_Face face = nullptr;
+  AssetBlob file;
+
+  ~FontFace();
+};
+
+// an opened font face, does not touch GL so it can be produced on a worker
+// thread
+struct FontData {
+  int fontSize = 0;
+  long maxHeight = 0;
+  FontMode mode = FontMode::Bitmap;
+  std::shared_ptr<FontFace> face;
 };
 
 class Font {
 public:
-  Font(const char *path, int size);
+  Font(const char *path, int size, FontMode mode = FontMode::Bitmap);
+  // a font file in memory, the data must outlive the font
+  Font(std::span<const uint8_t> data, int size,
+       FontMode mode = FontMode::Bitmap);
+  Font(FontData data);
+
+  // open the font face, glyphs are rasterized on first use. on failure out
+  // has no face and the font draws nothing
+  static bool Decode(const char *path, int size, FontData *out,
+                     FontMode mode = FontMode::Bitmap);
+  static bool Decode(std::span<const uint8_t> data, int size, FontData *out,
+                     FontMode mode = FontMode::Bitmap);
+
+  // text is UTF-8, scale is relative to the loaded size
   void RenderText(SpriteBatch *renderer, const char *text, glm::vec2 position,
                   glm::vec2 scale, glm::vec4 color,
                   glm::vec2 *outDims = nullptr, float wrapWidth = -1);
 
+  // lay out text into quads grouped by page instead of drawing it, see
+  // TextLayout. vertices and runs are appended to, returns the dimensions
+  // RenderText would report
+  glm::vec2 BuildText(const char *text, glm::vec2 position, glm::vec2 scale,
+                      glm::vec4 color, float wrapWidth,
+                      std::vector<Vertex> *vertices,
+                      std::vector<TextRun> *runs);
+
   int GetFontSize() { return this->fontSize; }
+  FontMode GetMode() const { return this->mode; }
+
+  // scale that draws this font at a pixel size, sdf fonts stay sharp at any
+  // scale while bitmap fonts blur away from 1
+  glm::vec2 GetScale(float pixelSize) const {
+    return glm::vec2(pixelSize / this->fontSize);
+  }
 
   // get text rect
   glm::vec2 GetTextDimensions(const char *text);
 
+  // memory held by the font, used for residency budgeting. the GPU share is
+  // the space this font's glyphs take in the shared cache pages
+  size_t GetCPUBytes() const {
+    return sizeof(Font) +
+           this->sparseGlyphs.size() * (sizeof(uint32_t) + sizeof(Glyph)) +
+           (this->face ? this->face->file.data.size() : 0);
+  }
+  size_t GetGPUBytes() const { return this->gpuBytes; }
+
 private:
+  void init(FontData &data);
+
+  // cached glyph for a codepoint, rasterized into the glyph cache on first use.
+  // a glyph that cannot be rendered is cached empty so it fails only once
+  const Glyph *getGlyph(uint32_t codepoint);
+  const Glyph *cacheGlyph(uint32_t codepoint, const Glyph &glyph);
+
+  // walks text, calling emit(glyph, topLeft) for every glyph with pixels,
+  // returns the text dimensions
+  template <typename Emit>
+  glm::vec2 layout(const char *text, glm::vec2 position, glm::vec2 scale,
+                   float wrapWidth, Emit emit);
+
+  // sprite batch flags for this font's glyph pages
+  uint8_t getPageFlags() const;
+
   int fontSize;
   long max_height;
+  FontMode mode = FontMode::Bitmap;
 
-  std::unordered_map<char, Glyph> glyphs;
-
-  GLuint tex;
-  int texDim = 1024;
-};
\ No newline at end of file
+  // latin 1 glyphs, almost every lookup is answered here without hashing
+  Glyph denseGlyphs[FONT_DENSE_GLYPHS];
+  std::bitset<FONT_DENSE_GLYPHS> denseLoaded;
+  std::unordered_map<uint32_t, Glyph> sparseGlyphs;
+  std::shared_ptr<FontFace> face;
+  std::shared_ptr<GlyphCache> cache;
+  size_t gpuBytes = 0;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "sprite-batch.hpp"
+
+#include <glm/glm.hpp>
+
+// frame times the graph scales to, bars taller than this are clipped
+#define FRAME_GRAPH_MAX_MS 50.0f
+
+// draws the profiler's recent frames as bars with the top left at position.
+// green is under 60 fps, yellow under 30 fps, red above. the GPU time of each
+// frame is drawn over its CPU bar when timer queries are available
+void DrawFrameGraph(SpriteBatch *spriteBatch, glm::vec2 position,
+                    glm::vec2 size);
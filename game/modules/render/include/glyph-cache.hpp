@@ -0,0 +1,66 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// single channel pages shared by every font face and size
+#define GLYPH_CACHE_PAGE_DIM 1024
+// the cache refuses new glyphs once every page is full
+#define GLYPH_CACHE_MAX_PAGES 4
+// empty texels around each glyph so filtering never bleeds into a neighbour
+#define GLYPH_CACHE_PADDING 1
+
+// where a glyph bitmap was placed
+struct GlyphSlot {
+  GLuint texture = 0;
+  glm::ivec2 position = glm::ivec2(0, 0);
+};
+
+// dynamic R8 glyph atlas, glyphs are packed into shelves as they are first
+// rasterized. must only be used on the thread recording draws, the
+// uploads are queued to the render thread
+class GlyphCache {
+public:
+  GlyphCache();
+  ~GlyphCache();
+
+  // the cache shared by all live fonts, created on first use and released
+  // with the last font. distance field glyphs get their own pages since they
+  // are sampled with linear filtering
+  static std::shared_ptr<GlyphCache> GetShared(bool distanceField = false);
+  // pages held by the shared caches that are alive, without creating any
+  static size_t GetSharedGPUBytes();
+
+  // copy a w x h coverage bitmap into a page, pitch is the row stride of
+  // pixels in bytes. returns false when every page is full
+  bool Insert(const uint8_t *pixels, int w, int h, int pitch, GlyphSlot *out);
+
+  int GetPageDim() const { return GLYPH_CACHE_PAGE_DIM; }
+  size_t GetPageCount() const { return this->pages.size(); }
+  size_t GetGPUBytes() const {
+    return this->pages.size() * GLYPH_CACHE_PAGE_DIM * GLYPH_CACHE_PAGE_DIM;
+  }
+
+private:
+  struct Shelf {
+    int y;
+    int height;
+    int cursor;
+  };
+
+  struct Page {
+    GLuint texture;
+    std::vector<Shelf> shelves;
+    int top;
+  };
+
+  // finds room for a w x h rect in a page, false when it does not fit
+  bool allocate(Page &page, int w, int h, glm::ivec2 *out);
+  void addPage();
+
+  std::vector<Page> pages;
+  std::vector<uint8_t> staging;
+};
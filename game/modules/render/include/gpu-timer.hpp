@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+
+// frames of timer queries in flight, results are read this many frames late
+// so the CPU never waits on the GPU
+#define GPU_TIMER_QUERIES 4
+
+// GPU time per frame through GL_TIME_ELAPSED queries (EXT_disjoint_timer_query
+// on GLES and WebGL2, ARB_timer_query on desktop GL). results are handed to
+// the profiler
+class GpuTimer {
+public:
+  GpuTimer();
+  ~GpuTimer();
+
+  bool IsSupported() const { return this->supported; }
+
+  // only one frame can be timed at a time, GL does not nest these queries
+  void BeginFrame(uint64_t frame);
+  void EndFrame();
+
+  // pass finished results to Profiler::SetGpuTime
+  void Collect();
+
+private:
+  bool supported = false;
+  bool active = false;
+  size_t next = 0;
+  GLuint queries[GPU_TIMER_QUERIES] = {};
+  uint64_t frames[GPU_TIMER_QUERIES] = {};
+  bool pending[GPU_TIMER_QUERIES] = {};
+};
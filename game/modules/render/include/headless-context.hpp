@@ -0,0 +1,30 @@
+#pragma once
+
+// an offscreen GLES3 context made with EGL on a surfaceless (Mesa) display,
+// no window or display server is needed. draws go to a framebuffer object
+// standing in for the default framebuffer
+class HeadlessContext {
+public:
+  // makes the context current and loads glad, check IsValid
+  HeadlessContext(int width, int height);
+  ~HeadlessContext();
+
+  bool IsValid() const { return this->valid; }
+
+  // move the context between threads, it is current on at most one
+  void MakeCurrent();
+  void Release();
+
+  // GL loader for this context, same signature as SDL_GL_GetProcAddress
+  static void *GetProcAddress(const char *name);
+
+private:
+  void *display = nullptr;
+  void *context = nullptr;
+  // only used when the display does not support surfaceless contexts
+  void *surface = nullptr;
+  unsigned int framebuffer = 0;
+  unsigned int colorbuffer = 0;
+  unsigned int depthbuffer = 0;
+  bool valid = false;
+};
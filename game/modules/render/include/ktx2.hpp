@@ -0,0 +1,31 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+// KTX2 container for GPU compressed textures written by the texture cooker,
+// only what the cooker emits is read back:
+//   vkFormat VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, 2D, one layer and face
+//   no supercompression, full or partial mip chain
+// cooked textures are kept up to date by the build (cook_textures re-cooks an
+// image whenever it changes), same as baked models
+#define KTX2_EXTENSION "ktx2"
+#define KTX2_VK_FORMAT_ETC2_RGBA8 151
+// largest width or height read back, far above anything the cooker emits
+#define KTX2_MAX_DIMENSION 16384
+
+// path of the cooked texture that sits next to a source image
+std::string GetCookedTexturePath(const std::string &sourcePath);
+
+// true when data starts with the KTX2 identifier
+bool IsKTX2(std::span<const uint8_t> data);
+
+// write the compressed levels of image, levels must be ETC2 RGBA8
+bool WriteKTX2(const ImageData &image, const std::string &path);
+
+// parse a cooked texture into out, the level data is copied so the blob can be
+// released afterwards
+bool ParseKTX2(std::span<const uint8_t> data, ImageData *out);
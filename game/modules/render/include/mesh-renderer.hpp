@@ -1,22 +1,134 @@
 #pragma once
 #include "shader.hpp"
 
+#include <cstdint>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <mutex>
+#include <vector>
 
 #include "mesh.hpp"
 
+// uniform buffer binding point used for the MaterialBlock
+#define MATERIAL_BLOCK_BINDING 0
+
+#define MESH_NEAR_PLANE 0.1f
+#define MESH_FAR_PLANE 100.0f
+
 class MeshRenderer {
 public:
   MeshRenderer();
+  ~MeshRenderer();
+
+  // draw immediately, prefer Submit + Flush when drawing many meshes. emissive
+  // overrides the material's emissive like InstanceData::emissive
+  void DrawMesh(Mesh *mesh, glm::mat4 model,
+                glm::vec4 emissive = MESH_MATERIAL_EMISSIVE);
+
+  // draw count copies of the mesh with a single draw call
+  void DrawMeshInstanced(Mesh *mesh, const InstanceData *instances,
+                         size_t count);
+  void DrawMeshInstanced(Mesh *mesh, const std::vector<InstanceData> &instances);
 
-  void DrawMesh(Mesh *mesh, glm::mat4 model);
+  // queue a mesh to be drawn on the next Flush, the queue is sorted by
+  // program, material, vertex array and depth before it is executed
+  void Submit(Mesh *mesh, glm::mat4 model,
+              glm::vec4 emissive = MESH_MATERIAL_EMISSIVE);
+  void Submit(Mesh *mesh, Material *material, glm::mat4 model,
+              glm::vec4 emissive = MESH_MATERIAL_EMISSIVE);
+
+  // draw everything in the queue, skipping redundant state changes, runs of
+  // the same mesh and material are merged into one instanced draw that keeps
+  // the emissive override of every instance
+  void Flush();
 
   void SetViewMatrix(glm::mat4 viewMatrix);
 
 private:
-  void setMaterialUniforms(GLuint shaderProgram, const Material *material);
+  struct DrawCommand {
+    Mesh *mesh;
+    Material *material;
+    glm::mat4 model;
+    glm::vec4 emissive;
+  };
+
+  // packed sort key and the index of the command it belongs to
+  struct SortKey {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  // what a draw needs from its mesh and material, captured by value so both
+  // may be destroyed before a recorded frame is drawn
+  struct MeshDraw {
+    GLuint vao;
+    GLsizei indexCount;
+    GLenum indexType;
+    VertexFormat format;
+    // 0 without a material
+    GLuint ubo;
+    GLuint instanceVbo;
+    size_t instanceCapacity;
+  };
+
+  // one draw of a flushed queue, runs of more than one instance are drawn
+  // instanced from instances[firstInstance]
+  struct DrawRun {
+    MeshDraw draw;
+    glm::mat4 model;
+    glm::vec4 emissive;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+  };
+
+  uint64_t makeSortKey(const Mesh *mesh, const Material *material,
+                       const glm::mat4 &model) const;
+
+  // snapshot of the mesh and material, uploads a dirty material block. on
+  // the recording thread
+  MeshDraw makeDraw(Mesh *mesh, Material *material);
+  void uploadMaterial(Material *material);
+
+  // the GL side of the public calls, run on the render thread
+  void createGLObjects();
+  void drawInstanced(const MeshDraw &draw, const InstanceData *instances,
+                     size_t count);
+  void drawRuns(const std::vector<DrawRun> &runs,
+                const std::vector<InstanceData> &instances);
+  void bindMaterial(GLuint ubo);
+  void setInstanced(bool instanced);
+  void setVertexFormat(VertexFormat format);
   Shader vertexShader;
   Shader fragmentShader;
   GLuint shaderProgram;
-};
\ No newline at end of file
+
+  glm::mat4 view;
+
+  std::vector<DrawCommand> queue;
+  std::vector<SortKey> sortKeys;
+  // built by Flush, kept for their capacity
+  std::vector<DrawRun> runs;
+  std::vector<InstanceData> runInstances;
+
+  // runs a flush hands to the render thread, which hands them back drawn so
+  // Flush builds into them instead of copying its runs for every flush
+  struct FlushRuns {
+    std::vector<DrawRun> runs;
+    std::vector<InstanceData> instances;
+  };
+  std::mutex spareMutex;
+  std::vector<FlushRuns> spareRuns;
+
+  bool instanced = false;
+  VertexFormat vertexFormat = VertexFormat::Float;
+
+  // uniform locations, resolved once after the program is linked
+  struct {
+    GLint model = -1;
+    GLint view = -1;
+    GLint projection = -1;
+    GLint instanced = -1;
+    GLint packedNormals = -1;
+    GLint emissive = -1;
+  } uniforms;
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 #include <memory>
 #include <vector>
 
@@ -27,25 +29,127 @@ struct Vertex3D {
   Vertex3D() {}
 };
 
+// std140 layout of the MaterialBlock uniform block in mesh.frag
+struct MaterialBlock {
+  glm::vec3 baseColorFactor;
+  float metallicFactor;
+  glm::vec3 emissiveFactor;
+  float emissiveStrength;
+  float roughnessFactor;
+  float padding[3];
+};
+
+// GPU layout of the vertex data, selectable per mesh
+enum class VertexFormat {
+  // Vertex3D as is, 48 bytes
+  Float,
+  // PackedVertex3D, 24 bytes: oct encoded snorm16 normals, half float texture
+  // coordinates and rgba8 colors
+  Packed,
+};
+
+struct PackedVertex3D {
+  glm::vec3 position;
+  glm::i16vec2 normal;
+  glm::u16vec2 texCoords;
+  glm::u8vec4 color;
+
+  PackedVertex3D(const Vertex3D &vertex);
+  PackedVertex3D() {}
+};
+
 struct Material {
+  Material();
+  ~Material();
+  // owns the uniform buffer
+  Material(const Material &) = delete;
+  Material &operator=(const Material &) = delete;
+
   glm::vec3 baseColorFactor;
   float metallicFactor;
   float roughnessFactor;
   glm::vec3 emissiveFactor;
   float emissiveStrength;
+
+  // call after changing any of the factors, the uniform buffer is only
+  // re-uploaded when the material is dirty
+  void MarkDirty() { this->dirty = true; }
+
+  MaterialBlock GetBlock() const;
+
+  // small unique id, used to group draws by material
+  uint16_t id;
+
+  GLuint ubo = 0;
+  bool dirty = true;
+};
+
+// emissive override that keeps the emissive factor and strength of the
+// material, any override with an alpha below zero does the same
+#define MESH_MATERIAL_EMISSIVE glm::vec4(0.0f, 0.0f, 0.0f, -1.0f)
+
+// per instance data for instanced draws
+struct InstanceData {
+  glm::mat4 model;
+  glm::vec4 emissive;
+
+  InstanceData(glm::mat4 model, glm::vec4 emissive = MESH_MATERIAL_EMISSIVE)
+      : model(model), emissive(emissive) {}
 };
 
+// Vertex and index data is uploaded to the GPU once at construction, the VAO
+// is baked at the same time so drawing only needs to bind it
 struct Mesh {
-  Mesh(std::vector<Vertex3D> vertices, std::vector<GLuint> indices);
+  Mesh(std::vector<Vertex3D> vertices, std::vector<GLuint> indices,
+       VertexFormat format = VertexFormat::Packed);
+  // upload GPU ready data as is, vertexData must be laid out for format and
+  // indexType is GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, nothing is kept on the
+  // CPU
+  Mesh(const void *vertexData, size_t vertexCount, VertexFormat format,
+       const void *indexData, size_t indexCount, GLenum indexType);
   ~Mesh();
 
+  // free the CPU side copies of the vertex and index data, the GPU buffers are
+  // kept so the mesh can still be drawn
+  void ReleaseCPUData();
+
+  // make room for count instances, the instance buffer and its attributes are
+  // added to the VAO on first use. on the recording thread
+  void ReserveInstances(size_t count);
+
+  // upload instance data into an instance buffer of capacity instances, on
+  // the render thread
+  static void UploadInstances(GLuint instanceVbo, size_t capacity,
+                              const InstanceData *instances, size_t count);
+
+  // memory held by the mesh, used for residency budgeting
+  size_t GetCPUBytes() const;
+  size_t GetGPUBytes() const;
+
   GLuint vbo;
   GLuint ebo;
   GLuint vao;
 
+  GLuint instanceVbo = 0;
+  size_t instanceCapacity = 0;
+
+  // size of the static vertex and index buffers
+  size_t bufferBytes = 0;
+
+  GLsizei indexCount;
+  GLenum indexType;
+  VertexFormat format;
+
   std::vector<Vertex3D> vertices;
   std::vector<GLuint> indices;
 
   glm::mat4 model = glm::mat4(1.0f);
   std::shared_ptr<Material> material;
+
+private:
+  void upload(const void *vertexData, size_t vertexBytes,
+              const void *indexData, size_t indexBytes);
 };
+
+// size in bytes of one vertex in the given format
+size_t GetVertexSize(VertexFormat format);
@@ -1,19 +1,65 @@
 #pragma once
 
+#include "archive.hpp"
 #include "mesh.hpp"
 
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
+// a mesh as parsed from disk, before anything is uploaded to the GPU
+struct MeshData {
+  std::vector<Vertex3D> vertices;
+  std::vector<GLuint> indices;
+  int material = 0;
+  glm::mat4 model = glm::mat4(1.0f);
+};
+
+// GL free representation of a model, shared by the runtime and the baker
+struct ModelData {
+  std::vector<MaterialBlock> materials;
+  std::vector<MeshData> meshes;
+};
+
+// everything read from disk for a model, produced without touching GL so it
+// can be loaded on a worker thread
+struct ModelSource {
+  // a validated baked model, uploaded as is
+  AssetBlob baked;
+  // the parsed glTF when there is no usable bake
+  ModelData data;
+};
+
 class Model {
 public:
   Model(std::string path);
+  // a baked model, glb or glTF json in memory, external glTF buffers are
+  // resolved against baseDir
+  Model(std::span<const uint8_t> data, const std::string &baseDir = "");
+  Model(ModelSource source);
+
+  // read a model file, prefers an up to date baked sibling of glTF files
+  static bool Load(const std::string &path, ModelSource *out);
+  static bool Load(std::span<const uint8_t> data, const std::string &baseDir,
+                   ModelSource *out);
 
   const std::vector<std::shared_ptr<Mesh>> getMeshes() { return meshes; }
 
+  // memory held by all meshes of the model
+  size_t GetCPUBytes() const;
+  size_t GetGPUBytes() const;
+
+  // parse a glTF / glb file without touching GL
+  static bool ParseGLTF(const std::string &path, ModelData *out);
+  static bool ParseGLTF(std::span<const uint8_t> data,
+                        const std::string &baseDir, ModelData *out);
+
 private:
-  void loadObj(std::string path);
-  void loadGLTF(std::string path);
+  static bool validateBaked(const AssetBlob &blob);
+  void uploadData(ModelData &data);
+  void uploadBaked(std::span<const uint8_t> data);
+  void setMaterials(const MaterialBlock *blocks, size_t count);
   std::vector<std::shared_ptr<Mesh>> meshes;
-};
\ No newline at end of file
+  std::vector<std::shared_ptr<Material>> materials;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+// GL work submitted in one frame
+struct RenderCounters {
+  uint32_t drawCalls = 0;
+  uint32_t programSwitches = 0;
+  uint32_t textureBinds = 0;
+  // bytes written into buffer objects, through glBufferData, glBufferSubData
+  // or a mapped range
+  uint64_t bufferBytes = 0;
+};
+
+// per frame counters for the draw paths of SpriteBatch and MeshRenderer.
+// double buffered, the frame being recorded is counted into while the last
+// finished frame stays readable. one instance is shared by the host and the
+// hot reloaded game through SharedData, only the render thread counts
+class RenderStats {
+public:
+  // the stats counting goes to, the game attaches to the host's because the
+  // host ends the frames
+  static RenderStats *Get();
+  static void Attach(RenderStats *stats);
+
+  static void CountDrawCall();
+  static void CountProgramSwitch();
+  static void CountTextureBind();
+  static void CountBufferBytes(size_t bytes);
+
+  // finish the frame being recorded, called by Renderer::Present
+  static void EndFrame();
+
+  // the last finished frame, readable from any thread
+  static RenderCounters GetLastFrame();
+  // the frame being recorded so far, only on the render thread
+  static const RenderCounters &GetCurrentFrame();
+  // frames finished so far
+  static uint64_t GetFrameCount();
+
+  // append a row per finished frame to a csv file until CloseCsv
+  static bool OpenCsv(const char *path);
+  static void CloseCsv();
+
+private:
+  // guards the swap against readers of the last frame
+  std::mutex mutex;
+  RenderCounters frames[2];
+  int current = 0;
+  uint64_t frameCount = 0;
+  FILE *csv = nullptr;
+};
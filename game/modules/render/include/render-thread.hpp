@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// runs GL work on a thread that owns the context. the main thread records
+// each frame's commands while the render thread executes the previous frame,
+// so simulation and vsync'ed swaps overlap. until Start (and always on the
+// web build) every command runs inline on the calling thread.
+//
+// commands capture GL names and plain values where they can, since the
+// object may be destroyed before its frame is drawn. deletes are queued
+// behind the draws that use the names. objects that queued commands still
+// point at (SpriteBatch, MeshRenderer) Drain before they are destroyed
+class RenderThread {
+public:
+  using Command = std::function<void()>;
+
+  // the render thread commands go to, the game attaches to the host's so
+  // both sides of a hot reload share one command stream
+  static RenderThread *Get();
+  static void Attach(RenderThread *thread);
+
+  // move the context to a new thread, acquire and release make it current
+  // and not current there. the caller must release it first
+  static void Start(Command acquire, Command release);
+  // drain and join, the context is released on the render thread
+  static void Stop();
+
+  // true while commands are deferred to the render thread
+  static bool IsThreaded();
+  static bool IsRenderThread();
+
+  // record a command into the frame being built, runs it now without a
+  // render thread or when already on it
+  static void Submit(Command command);
+
+  // run a command on the render thread and wait for it, for resource
+  // creation and readbacks. it runs between the commands of the frame being
+  // drawn, so it must not depend on the frame being recorded or change a
+  // binding that frame's commands leave for the next one, record those
+  static void Call(const Command &command);
+
+  // hand the recorded frame to the render thread, waits while it is still
+  // drawing the frame before
+  static void EndFrame();
+
+  // submit what is recorded and wait until all of it has run, call before
+  // anything the commands reference goes away (hot reload, shutdown)
+  static void Drain();
+
+private:
+  struct PendingCall {
+    const Command *command;
+    // set by the render thread with the lock held
+    bool *finished;
+  };
+
+  void run();
+  // runs the calls waiting on the render thread, with the lock held
+  void runCalls(std::unique_lock<std::mutex> &lock);
+
+  std::thread thread;
+  std::thread::id threadId;
+  Command release;
+  bool running = false;
+  bool stopping = false;
+
+  std::mutex mutex;
+  // signals the render thread: a frame or a call is waiting, or stop
+  std::condition_variable wake;
+  // signals the main thread: a frame or a call finished
+  std::condition_variable done;
+
+  std::vector<Command> recording;
+  std::vector<Command> executing;
+  bool frameReady = false;
+  std::vector<PendingCall> calls;
+};
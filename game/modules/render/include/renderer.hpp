@@ -3,6 +3,7 @@
 #include <SDL.h>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,17 +14,44 @@
 #define ASPECT_RATIO ((float)WINDOW_WIDTH / (float)WINDOW_HEIGHT)
 
 class Window;
+class HeadlessContext;
+class GpuTimer;
+
+// loads GL functions for the current context, matches SDL_GL_GetProcAddress
+typedef void *(*GLProcLoader)(const char *name);
 
 class Renderer {
 public:
   Renderer(Window *window);
+  // offscreen renderer without a window or display, draws into a framebuffer
+  // object on an EGL context
+  Renderer(int width, int height);
   ~Renderer();
 
+  // recorded for the render thread once it is started, Present hands the
+  // frame over
   void Clear();
   void Present();
 
+  // move the context to a render thread, see RenderThread. the context is
+  // moved back when the renderer is destroyed
+  void StartRenderThread();
+
+  bool IsValid() const { return this->valid; }
+  bool IsHeadless() const { return this->headless != nullptr; }
+
+  // loader for the game's own glad, the context may not belong to SDL
+  GLProcLoader GetProcLoader() const;
+
 private:
-  SDL_GLContext glContext;
+  void initState();
+
+  SDL_Window *window = nullptr;
+  SDL_GLContext glContext = nullptr;
+  std::unique_ptr<HeadlessContext> headless;
+  // times each frame from Clear to Present for the profiler
+  std::unique_ptr<GpuTimer> gpuTimer;
+  bool valid = false;
 
   static void APIENTRY openglCallbackFunction(GLenum source, GLenum type,
                                               GLuint id, GLenum severity,
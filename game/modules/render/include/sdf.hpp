@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// builds a signed distance field from a coverage bitmap, used for freetype
+// builds without the sdf renderer (the emscripten port). the output is
+// (w + spread * 2) x (h + spread * 2) bytes, 128 on the edge and larger
+// inside, matching FT_RENDER_MODE_SDF
+void GenerateSDF(const uint8_t *coverage, int w, int h, int pitch, int spread,
+                 std::vector<uint8_t> *out);
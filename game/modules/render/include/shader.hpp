@@ -12,6 +12,9 @@ public:
   void AttatchToProgram(GLuint program);
 
 private:
-  GLuint shader;
+  // runs on the render thread
+  bool compile(const char *source, GLenum shaderType);
+
+  GLuint shader = 0;
   GLuint type;
 };
\ No newline at end of file
@@ -1,21 +1,83 @@
 #pragma once
 #include "shader.hpp"
 #include "texture.hpp"
+#include "vertex-packing.hpp"
 
 #include <SDL.h>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <mutex>
+#include <span>
 #include <vector>
 
+// maximum number of sprites in a single batch, the batch is flushed when full
+#define SPRITE_BATCH_MAX_SPRITES 4096
+
+// the streaming vertex buffer is split into regions that are written round
+// robin, each region is fenced so we never write over vertices in flight
+#define SPRITE_BATCH_BUFFER_REGIONS 3
+
+// total sprites in the vertex buffer, every vertex must be addressable by the
+// 16 bit index buffer
+#define SPRITE_BATCH_BUFFER_SPRITES                                            \
+  (SPRITE_BATCH_MAX_SPRITES * SPRITE_BATCH_BUFFER_REGIONS)
+
+// number of textures a single batch can sample from, keep in sync with
+// MAX_TEXTURES in sprite.frag
+#define SPRITE_BATCH_MAX_TEXTURES 8
+
+// texture index for untextured quads, the shader only uses the vertex color
+#define SPRITE_BATCH_NO_TEXTURE 255
+
+// texture index flag for single channel textures (glyph pages), the shader
+// spreads red over rgba since webgl has no texture swizzle. keep in sync with
+// ALPHA_TEXTURE in sprite.frag
+#define SPRITE_BATCH_ALPHA_TEXTURE 0x80
+
+// texture index flag for signed distance field glyph pages, decoded in the
+// shader and sampled with linear filtering. keep in sync with SDF_TEXTURE in
+// sprite.frag
+#define SPRITE_BATCH_SDF_TEXTURE 0x40
+
+// texture index bits that hold the slot
+#define SPRITE_BATCH_SLOT_MASK 0x3F
+
+// 20 bytes, texture coordinates are unorm16 and the color is rgba8
 struct Vertex {
   glm::vec2 position;
-  glm::vec2 texCoords;
-  glm::vec4 color;
+  glm::u16vec2 texCoords;
+  glm::u8vec4 color;
+  uint8_t textureIndex;
+  uint8_t padding[3];
+
+  // uninitialized, for buffers that are filled in place
+  Vertex() {}
+  Vertex(glm::vec2 position, glm::vec2 texCoords, glm::vec4 color,
+         GLuint textureIndex)
+      : position(position),
+        texCoords(PackUnorm16(texCoords.x), PackUnorm16(texCoords.y)),
+        color(PackUnorm8(color.x), PackUnorm8(color.y), PackUnorm8(color.z),
+              PackUnorm8(color.w)),
+        textureIndex(textureIndex) {}
+};
 
-  Vertex(glm::vec2 position, glm::vec2 texCoords, glm::vec4 color)
-      : position(position), texCoords(texCoords), color(color) {}
+// one axis aligned sprite for DrawMany
+struct SpriteInstance {
+  // x, y, w, h in pixels
+  glm::vec4 destRect;
+  // x, y, w, h in texels
+  glm::vec4 srcRect;
+  glm::u8vec4 color;
 };
 
+// writes 4 vertices per sprite to out, uvs are srcRect * invTextureSize.
+// the inner loop of DrawMany, the corners and uvs of a sprite are computed
+// with simd.hpp and its vertices are written field by field
+void GenerateSpriteQuads(const SpriteInstance *sprites, size_t count,
+                         glm::vec2 invTextureSize, uint8_t textureIndex,
+                         Vertex *out);
+
 class SpriteBatch {
 public:
   SpriteBatch(glm::vec2 windowSize);
@@ -35,18 +97,70 @@ public:
             glm::vec4 srcRect = glm::vec4(0, 0, 0, 0),
             glm::vec2 flipPadding = glm::vec2(0, 0));
 
+  // many unrotated sprites from one texture, much faster than calling Draw
+  // for each of them
+  void DrawMany(Texture *texture, std::span<const SpriteInstance> sprites);
+  void DrawMany(GLuint texture, std::span<const SpriteInstance> sprites);
+
   void DrawRect(glm::vec4 destRect, glm::vec4 color = glm::vec4(1, 1, 1, 1));
+
+  // copy pre-built quads (4 vertices each, see TextLayout) that all sample
+  // texture, only the texture index of each vertex is rewritten
+  void Append(std::span<const Vertex> quads, GLuint texture,
+              uint8_t flags = 0);
   void Flush();
 
   void SetProjection(glm::vec2 windowSize);
 
-  void SetTextureAndDimensions(GLuint texture, const int w, const int h);
+  // flags (SPRITE_BATCH_ALPHA_TEXTURE, SPRITE_BATCH_SDF_TEXTURE) apply to the
+  // following draws
+  void SetTextureAndDimensions(GLuint texture, const int w, const int h,
+                               uint8_t flags = 0);
+
+  // outline drawn around sdf text, width and softness are in distance field
+  // units (0.5 reaches the edge of the spread). a wide soft outline is a glow,
+  // flushes the batch when it changes
+  void SetTextOutline(float width, float softness = 0.0f,
+                      glm::vec4 color = glm::vec4(0, 0, 0, 1));
 
 private:
+  // everything a flush draws with besides the vertices, copied so recording
+  // can go on while the render thread draws
+  struct FlushState {
+    GLuint textures[SPRITE_BATCH_MAX_TEXTURES];
+    size_t textureCount;
+    uint32_t linearSlots;
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec2 textOutline;
+    glm::vec4 textOutlineColor;
+  };
+
+  // run on the render thread, see RenderThread
+  void createGLObjects(glm::vec2 windowSize);
+  void deleteGLObjects();
+  void draw(std::span<const Vertex> vertices, const FlushState &state);
+
+  // returns the first sprite slot in the vertex buffer to write count sprites
+  // to, waiting for the GPU if the region is still in use
+  size_t reserveSprites(size_t count);
+
+  // returns the slot of the texture in this batch, flushing first if all the
+  // slots are taken by other textures
+  GLuint acquireTextureSlot(GLuint texture);
+
   std::vector<Vertex> vertices;
+  // vectors the render thread has drawn and handed back, Flush records into
+  // one of them instead of copying the vertices for every flush
+  std::mutex spareMutex;
+  std::vector<std::vector<Vertex>> spareVertices;
   GLuint vbo;
 
-  std::vector<GLuint> indices;
+  // sprite slot in the vertex buffer the next flush is written to
+  size_t bufferCursor = 0;
+  GLsync regionFences[SPRITE_BATCH_BUFFER_REGIONS] = {};
+
+  // static index buffer, the quad pattern never changes
   GLuint ebo;
 
   GLuint vao;
@@ -58,8 +172,24 @@ private:
 
   GLuint texture;
   glm::ivec4 textureRect;
+  uint8_t textureFlags = 0;
   GLuint textureUniform;
 
+  // textures sampled by the current batch, indexed by Vertex::textureIndex
+  GLuint textures[SPRITE_BATCH_MAX_TEXTURES];
+  size_t textureCount = 0;
+
+  // nearest filtering for all sprite textures, set once instead of per flush
+  GLuint sampler;
+  // distance fields need linear filtering, one bit per slot using it
+  GLuint linearSampler;
+  uint32_t linearSlots = 0;
+
+  glm::vec2 textOutline = glm::vec2(0.0f);
+  glm::vec4 textOutlineColor = glm::vec4(0, 0, 0, 1);
+  GLuint textOutlineUniform;
+  GLuint textOutlineColorUniform;
+
   glm::mat4 projection;
   GLuint projectionUniform;
 
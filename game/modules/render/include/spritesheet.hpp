@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <memory>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -20,9 +22,19 @@ struct SpriteAnimation {
   SpriteAnimation() : frames({0}), frameTime(0.0f), dimensions(glm::vec2(0)) {}
 };
 
+// a parsed atlas json, does not touch GL
+struct SpriteAtlasData {
+  std::string texturePath;
+  // x, y, w, h per sprite
+  std::vector<int> atlas;
+  std::unordered_map<std::string, SpriteAnimation> animations;
+};
+
 class SpriteSheet {
 public:
   SpriteSheet(const char *atlasPath);
+  // atlas json in memory, the texture path in it is relative to atlasDir
+  SpriteSheet(std::span<const uint8_t> atlasJson, const char *atlasDir);
   ~SpriteSheet();
 
   Texture *GetTexture();
@@ -35,14 +47,17 @@ public:
 
   glm::vec4 GetAnimationRect(const SpriteAnimation *animation, size_t index);
 
-private:
-  struct SpriteAtlas {
-    std::string texturePath;
-    std::unordered_map<std::string, SpriteAnimation> animations;
-    std::vector<glm::vec4> atlas;
-  };
+  // memory held by the sheet and its texture, used for residency budgeting
+  size_t GetCPUBytes() const;
+  size_t GetGPUBytes() const;
+
+  // parse atlas json without loading the texture
+  static bool ParseAtlas(std::span<const uint8_t> atlasJson,
+                         SpriteAtlasData *out);
 
-  void loadAtlas(const char *atlasPath);
+private:
+  void loadAtlas(std::span<const uint8_t> atlasData,
+                 const std::string &atlasDir);
 
   std::shared_ptr<Texture> texture;
   std::vector<int> atlas;
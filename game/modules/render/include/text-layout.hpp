@@ -0,0 +1,39 @@
+#pragma once
+#include "font.hpp"
+#include "sprite-batch.hpp"
+
+#include <glm/glm.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// positioned glyph quads for a string, laid out again only when the text or
+// its placement changes. drawing copies the quads into the batch, so static
+// and slowly changing text (HUD counters) costs about a memcpy per frame.
+// the font must outlive the layout
+class TextLayout {
+public:
+  // returns true when the quads were rebuilt
+  bool Set(Font *font, std::string_view text, glm::vec2 position,
+           glm::vec2 scale = glm::vec2(1, 1),
+           glm::vec4 color = glm::vec4(1, 1, 1, 1), float wrapWidth = -1);
+
+  void Draw(SpriteBatch *renderer) const;
+
+  // dimensions RenderText would report for the text
+  glm::vec2 GetDimensions() const { return this->dimensions; }
+
+  bool IsEmpty() const { return this->vertices.empty(); }
+
+private:
+  Font *font = nullptr;
+  std::string text;
+  glm::vec2 position = glm::vec2(0.0f);
+  glm::vec2 scale = glm::vec2(0.0f);
+  glm::vec4 color = glm::vec4(0.0f);
+  float wrapWidth = -1;
+
+  std::vector<Vertex> vertices;
+  std::vector<TextRun> runs;
+  glm::vec2 dimensions = glm::vec2(0.0f);
+};
@@ -1,18 +1,62 @@
 #pragma once
 #include <glad/glad.h>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+// one mip level inside ImageData::pixels
+struct ImageLevel {
+  int w;
+  int h;
+  size_t offset;
+  size_t size;
+};
+
+// RGBA8 pixels decoded from an image file, or the compressed mip chain of a
+// cooked texture. does not touch GL so it can be produced on a worker thread
+struct ImageData {
+  std::vector<unsigned char> pixels;
+  int w = 0;
+  int h = 0;
+  // 0 for RGBA8 pixels, otherwise the GL format of every level
+  GLenum compressedFormat = 0;
+  // level 0 first, empty for a single RGBA8 level
+  std::vector<ImageLevel> levels;
+};
 
 class Texture {
 public:
   Texture(const char *filename);
+  // an encoded image file in memory
+  Texture(std::span<const uint8_t> data);
+  Texture(const ImageData &image);
   ~Texture();
 
+  // decode an image file into RGBA8 pixels, a cooked KTX2 texture next to the
+  // image is used instead when it is up to date
+  static bool Decode(const char *filename, ImageData *out);
+  static bool Decode(std::span<const uint8_t> data, ImageData *out);
+
+  // compressed formats the current context can sample, the Renderer queries
+  // them for every context it makes and uploads query them on first use
+  // otherwise. on the thread the context is current on
+  static void QueryCompressedFormats();
+
   GLuint GetGLTexture();
 
   glm::ivec4 GetTextureRect();
 
+  // memory held by the texture, used for residency budgeting
+  size_t GetCPUBytes() const { return sizeof(Texture); }
+  size_t GetGPUBytes() const { return this->gpuBytes; }
+
 private:
-  GLuint texture;
-  int w;
-  int h;
-};
\ No newline at end of file
+  void upload(const ImageData &image);
+  void uploadCompressed(const ImageData &image);
+
+  GLuint texture = 0;
+  int w = 0;
+  int h = 0;
+  size_t gpuBytes = 0;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// helpers to convert float vertex attributes into compact GPU formats
+
+inline uint8_t PackUnorm8(float value) {
+  return (uint8_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+inline uint16_t PackUnorm16(float value) {
+  return (uint16_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+inline int16_t PackSnorm16(float value) {
+  return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+inline uint16_t PackHalf(float value) { return glm::packHalf1x16(value); }
+
+// octahedral normal encoding, maps a unit vector onto 2 components in [-1, 1]
+// https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+inline glm::vec2 OctEncode(glm::vec3 n) {
+  const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  if (l1 == 0.0f) {
+    return glm::vec2(0.0f, 0.0f);
+  }
+  float x = n.x / l1;
+  float y = n.y / l1;
+  if (n.z < 0.0f) {
+    const float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    const float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = ox;
+    y = oy;
+  }
+  return glm::vec2(x, y);
+}
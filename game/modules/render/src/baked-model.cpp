@@ -0,0 +1,144 @@
+#include "baked-model.hpp"
+
+#include <SDL.h>
+#include <cstring>
+#include <fstream>
+
+static uint64_t alignOffset(uint64_t offset) {
+  return (offset + BAKED_MODEL_ALIGNMENT - 1) &
+         ~(uint64_t)(BAKED_MODEL_ALIGNMENT - 1);
+}
+
+std::string GetBakedModelPath(const std::string &sourcePath) {
+  return sourcePath.substr(0, sourcePath.find_last_of('.') + 1) +
+         BAKED_MODEL_EXTENSION;
+}
+
+bool WriteBakedModel(const ModelData &data, VertexFormat format,
+                     const std::string &path) {
+  BakedModelHeader header = {};
+  header.magic = BAKED_MODEL_MAGIC;
+  header.version = BAKED_MODEL_VERSION;
+  header.materialCount = data.materials.size();
+  header.meshCount = data.meshes.size();
+
+  // lay out the tables first, then every vertex and index block
+  std::vector<BakedMesh> bakedMeshes(data.meshes.size());
+  uint64_t offset = sizeof(BakedModelHeader) +
+                    data.materials.size() * sizeof(MaterialBlock) +
+                    data.meshes.size() * sizeof(BakedMesh);
+  for (size_t i = 0; i < data.meshes.size(); i++) {
+    const MeshData &mesh = data.meshes[i];
+    BakedMesh &baked = bakedMeshes[i];
+    baked.vertexCount = mesh.vertices.size();
+    baked.indexCount = mesh.indices.size();
+    baked.vertexFormat = (uint32_t)format;
+    baked.material = mesh.material;
+    // the smallest index type that addresses every vertex
+    baked.indexType = mesh.vertices.size() <= 0xFFFF ? GL_UNSIGNED_SHORT
+                                                     : GL_UNSIGNED_INT;
+    memcpy(baked.model, &mesh.model, sizeof(baked.model));
+
+    offset = alignOffset(offset);
+    baked.vertexOffset = offset;
+    offset += baked.vertexCount * GetVertexSize(format);
+
+    offset = alignOffset(offset);
+    baked.indexOffset = offset;
+    offset += baked.indexCount * (baked.indexType == GL_UNSIGNED_SHORT
+                                      ? sizeof(GLushort)
+                                      : sizeof(GLuint));
+  }
+  header.fileSize = offset;
+
+  std::vector<uint8_t> blob(header.fileSize, 0);
+  uint8_t *cursor = blob.data();
+  memcpy(cursor, &header, sizeof(header));
+  cursor += sizeof(header);
+  memcpy(cursor, data.materials.data(),
+         data.materials.size() * sizeof(MaterialBlock));
+  cursor += data.materials.size() * sizeof(MaterialBlock);
+  memcpy(cursor, bakedMeshes.data(), bakedMeshes.size() * sizeof(BakedMesh));
+
+  for (size_t i = 0; i < data.meshes.size(); i++) {
+    const MeshData &mesh = data.meshes[i];
+    const BakedMesh &baked = bakedMeshes[i];
+
+    if (format == VertexFormat::Packed) {
+      PackedVertex3D *vertices =
+          reinterpret_cast<PackedVertex3D *>(&blob[baked.vertexOffset]);
+      for (size_t v = 0; v < mesh.vertices.size(); v++) {
+        vertices[v] = PackedVertex3D(mesh.vertices[v]);
+      }
+    } else {
+      memcpy(&blob[baked.vertexOffset], mesh.vertices.data(),
+             mesh.vertices.size() * sizeof(Vertex3D));
+    }
+
+    if (baked.indexType == GL_UNSIGNED_SHORT) {
+      GLushort *indices =
+          reinterpret_cast<GLushort *>(&blob[baked.indexOffset]);
+      for (size_t n = 0; n < mesh.indices.size(); n++) {
+        indices[n] = (GLushort)mesh.indices[n];
+      }
+    } else {
+      memcpy(&blob[baked.indexOffset], mesh.indices.data(),
+             mesh.indices.size() * sizeof(GLuint));
+    }
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not open %s for writing",
+                 path.c_str());
+    return false;
+  }
+  file.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+  return (bool)file;
+}
+
+const BakedModelHeader *ValidateBakedModel(const uint8_t *data, size_t size) {
+  if (data == nullptr || size < sizeof(BakedModelHeader)) {
+    return nullptr;
+  }
+
+  const auto *header = reinterpret_cast<const BakedModelHeader *>(data);
+  if (header->magic != BAKED_MODEL_MAGIC ||
+      header->version != BAKED_MODEL_VERSION || header->fileSize != size ||
+      header->materialCount == 0) {
+    return nullptr;
+  }
+
+  const uint64_t tablesEnd = sizeof(BakedModelHeader) +
+                             header->materialCount * sizeof(MaterialBlock) +
+                             header->meshCount * sizeof(BakedMesh);
+  if (tablesEnd > size) {
+    return nullptr;
+  }
+
+  const auto *meshes = reinterpret_cast<const BakedMesh *>(
+      data + sizeof(BakedModelHeader) +
+      header->materialCount * sizeof(MaterialBlock));
+  for (uint32_t i = 0; i < header->meshCount; i++) {
+    const BakedMesh &mesh = meshes[i];
+    if (mesh.vertexFormat > (uint32_t)VertexFormat::Packed ||
+        (mesh.indexType != GL_UNSIGNED_SHORT &&
+         mesh.indexType != GL_UNSIGNED_INT) ||
+        mesh.material >= header->materialCount) {
+      return nullptr;
+    }
+    const uint64_t vertexBytes =
+        (uint64_t)mesh.vertexCount *
+        GetVertexSize((VertexFormat)mesh.vertexFormat);
+    const uint64_t indexBytes =
+        (uint64_t)mesh.indexCount *
+        (mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort)
+                                             : sizeof(GLuint));
+    if (mesh.vertexOffset < tablesEnd || mesh.indexOffset < tablesEnd ||
+        mesh.vertexOffset + vertexBytes > size ||
+        mesh.indexOffset + indexBytes > size) {
+      return nullptr;
+    }
+  }
+  return header;
+}
@@ -0,0 +1,413 @@
+#include "etc2.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+// ETC1 intensity modifiers, per table {small, large}
+static const int etcModifiers[8][2] = {{2, 8},   {5, 17},  {9, 29},
+                                       {13, 42}, {18, 60}, {24, 80},
+                                       {33, 106}, {47, 183}};
+
+// T and H mode distances
+static const int etcDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+// EAC alpha modifiers
+static const int eacModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+static inline int clamp255(int value) { return std::clamp(value, 0, 255); }
+
+// blocks are stored as big endian 64 bit words
+static uint64_t readBlock(const uint8_t *data) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+
+static void writeBlock(uint64_t value, uint8_t *data) {
+  for (int i = 7; i >= 0; i--) {
+    data[i] = value & 0xFF;
+    value >>= 8;
+  }
+}
+
+static inline uint32_t bits(uint64_t block, int high, int low) {
+  return (block >> low) & ((1ull << (high - low + 1)) - 1);
+}
+
+static inline int extend4(int c) { return (c << 4) | c; }
+static inline int extend5(int c) { return (c << 3) | (c >> 2); }
+static inline int extend6(int c) { return (c << 2) | (c >> 4); }
+static inline int extend7(int c) { return (c << 1) | (c >> 6); }
+
+// modifier index as stored, msb in the high half of the pixel bits, pixels
+// are numbered column major
+static inline int pixelIndex(uint64_t block, int x, int y) {
+  const int i = x * 4 + y;
+  return (bits(block, 16 + i, 16 + i) << 1) | bits(block, i, i);
+}
+
+static void decodeColor(uint64_t block, uint8_t *pixels) {
+  int paint[4][3];
+  const bool diff = bits(block, 33, 33);
+
+  const int r = bits(block, 63, 59), dr = bits(block, 58, 56);
+  const int g = bits(block, 55, 51), dg = bits(block, 50, 48);
+  const int b = bits(block, 47, 43), db = bits(block, 42, 40);
+  const int r2 = r + ((dr ^ 4) - 4);
+  const int g2 = g + ((dg ^ 4) - 4);
+  const int b2 = b + ((db ^ 4) - 4);
+
+  if (diff && (r2 < 0 || r2 > 31)) {
+    // T mode
+    const int c1[3] = {
+        extend4((bits(block, 60, 59) << 2) | bits(block, 57, 56)),
+        extend4(bits(block, 55, 52)), extend4(bits(block, 51, 48))};
+    const int c2[3] = {extend4(bits(block, 47, 44)),
+                       extend4(bits(block, 43, 40)),
+                       extend4(bits(block, 39, 36))};
+    const int d =
+        etcDistances[(bits(block, 35, 34) << 1) | bits(block, 32, 32)];
+    for (int c = 0; c < 3; c++) {
+      paint[0][c] = c1[c];
+      paint[1][c] = clamp255(c2[c] + d);
+      paint[2][c] = c2[c];
+      paint[3][c] = clamp255(c2[c] - d);
+    }
+  } else if (diff && (g2 < 0 || g2 > 31)) {
+    // H mode
+    const int c1[3] = {
+        extend4(bits(block, 62, 59)),
+        extend4((bits(block, 58, 56) << 1) | bits(block, 52, 52)),
+        extend4((bits(block, 51, 51) << 3) | bits(block, 49, 47))};
+    const int c2[3] = {extend4(bits(block, 46, 43)),
+                       extend4(bits(block, 42, 39)),
+                       extend4(bits(block, 38, 35))};
+    const int v1 = (c1[0] << 16) | (c1[1] << 8) | c1[2];
+    const int v2 = (c2[0] << 16) | (c2[1] << 8) | c2[2];
+    const int d = etcDistances[(bits(block, 34, 34) << 2) |
+                               (bits(block, 32, 32) << 1) | (v1 >= v2)];
+    for (int c = 0; c < 3; c++) {
+      paint[0][c] = clamp255(c1[c] + d);
+      paint[1][c] = clamp255(c1[c] - d);
+      paint[2][c] = clamp255(c2[c] + d);
+      paint[3][c] = clamp255(c2[c] - d);
+    }
+  } else if (diff && (b2 < 0 || b2 > 31)) {
+    // planar mode, no per pixel indices
+    const int o[3] = {
+        extend6(bits(block, 62, 57)),
+        extend7((bits(block, 56, 56) << 6) | bits(block, 54, 49)),
+        extend6((bits(block, 48, 48) << 5) | (bits(block, 44, 43) << 3) |
+                bits(block, 41, 39))};
+    const int h[3] = {
+        extend6((bits(block, 38, 34) << 1) | bits(block, 32, 32)),
+        extend7(bits(block, 31, 25)), extend6(bits(block, 24, 19))};
+    const int v[3] = {extend6(bits(block, 18, 13)),
+                      extend7(bits(block, 12, 6)),
+                      extend6(bits(block, 5, 0))};
+    for (int y = 0; y < 4; y++) {
+      for (int x = 0; x < 4; x++) {
+        uint8_t *pixel = &pixels[(y * 4 + x) * 4];
+        for (int c = 0; c < 3; c++) {
+          pixel[c] = clamp255(
+              (x * (h[c] - o[c]) + y * (v[c] - o[c]) + 4 * o[c] + 2) >> 2);
+        }
+      }
+    }
+    return;
+  } else {
+    // individual or differential mode, two sub blocks with a base color each
+    int base[2][3];
+    if (diff) {
+      base[0][0] = extend5(r), base[0][1] = extend5(g),
+      base[0][2] = extend5(b);
+      base[1][0] = extend5(r2), base[1][1] = extend5(g2),
+      base[1][2] = extend5(b2);
+    } else {
+      base[0][0] = extend4(bits(block, 63, 60));
+      base[1][0] = extend4(bits(block, 59, 56));
+      base[0][1] = extend4(bits(block, 55, 52));
+      base[1][1] = extend4(bits(block, 51, 48));
+      base[0][2] = extend4(bits(block, 47, 44));
+      base[1][2] = extend4(bits(block, 43, 40));
+    }
+    const int table[2] = {(int)bits(block, 39, 37), (int)bits(block, 36, 34)};
+    const bool flip = bits(block, 32, 32);
+
+    for (int y = 0; y < 4; y++) {
+      for (int x = 0; x < 4; x++) {
+        const int sub = flip ? (y >= 2) : (x >= 2);
+        const int index = pixelIndex(block, x, y);
+        const int magnitude = etcModifiers[table[sub]][index & 1];
+        const int modifier = (index & 2) ? -magnitude : magnitude;
+        uint8_t *pixel = &pixels[(y * 4 + x) * 4];
+        for (int c = 0; c < 3; c++) {
+          pixel[c] = clamp255(base[sub][c] + modifier);
+        }
+      }
+    }
+    return;
+  }
+
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) {
+      const int *color = paint[pixelIndex(block, x, y)];
+      uint8_t *pixel = &pixels[(y * 4 + x) * 4];
+      pixel[0] = color[0];
+      pixel[1] = color[1];
+      pixel[2] = color[2];
+    }
+  }
+}
+
+static void decodeAlpha(uint64_t block, uint8_t *pixels) {
+  const int base = bits(block, 63, 56);
+  const int multiplier = bits(block, 55, 52);
+  const int *modifiers = eacModifiers[bits(block, 51, 48)];
+  for (int x = 0; x < 4; x++) {
+    for (int y = 0; y < 4; y++) {
+      const int i = x * 4 + y;
+      const int index = bits(block, 47 - i * 3, 45 - i * 3);
+      pixels[(y * 4 + x) * 4 + 3] =
+          clamp255(base + modifiers[index] * multiplier);
+    }
+  }
+}
+
+size_t GetETC2ImageSize(int w, int h) {
+  return (size_t)((w + 3) / 4) * ((h + 3) / 4) * ETC2_BLOCK_SIZE;
+}
+
+void DecodeETC2Block(const uint8_t *block, uint8_t *pixels) {
+  decodeAlpha(readBlock(block), pixels);
+  decodeColor(readBlock(block + 8), pixels);
+}
+
+// error of the best modifier for every pixel of a sub block, indices are
+// written to the block when out is not null
+static int fitSubBlock(const uint8_t *pixels, const int *base, int table,
+                       bool flip, int sub, uint64_t *out) {
+  int error = 0;
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) {
+      if ((flip ? (y >= 2) : (x >= 2)) != sub) {
+        continue;
+      }
+      const uint8_t *pixel = &pixels[(y * 4 + x) * 4];
+      int bestError = INT_MAX, bestIndex = 0;
+      for (int index = 0; index < 4; index++) {
+        const int magnitude = etcModifiers[table][index & 1];
+        const int modifier = (index & 2) ? -magnitude : magnitude;
+        int e = 0;
+        for (int c = 0; c < 3; c++) {
+          const int d = clamp255(base[c] + modifier) - pixel[c];
+          e += d * d;
+        }
+        if (e < bestError) {
+          bestError = e;
+          bestIndex = index;
+        }
+      }
+      error += bestError;
+      if (out != nullptr) {
+        const int i = x * 4 + y;
+        *out |= (uint64_t)(bestIndex >> 1) << (16 + i);
+        *out |= (uint64_t)(bestIndex & 1) << i;
+      }
+    }
+  }
+  return error;
+}
+
+static int bestTable(const uint8_t *pixels, const int *base, bool flip,
+                     int sub, int *errorOut) {
+  int best = 0, bestError = INT_MAX;
+  for (int table = 0; table < 8; table++) {
+    const int error = fitSubBlock(pixels, base, table, flip, sub, nullptr);
+    if (error < bestError) {
+      bestError = error;
+      best = table;
+    }
+  }
+  *errorOut = bestError;
+  return best;
+}
+
+static uint64_t encodeColor(const uint8_t *pixels) {
+  uint64_t bestBlock = 0;
+  int bestError = INT_MAX;
+
+  for (int flip = 0; flip < 2; flip++) {
+    // average color of both sub blocks
+    int average[2][3] = {};
+    for (int y = 0; y < 4; y++) {
+      for (int x = 0; x < 4; x++) {
+        const int sub = flip ? (y >= 2) : (x >= 2);
+        for (int c = 0; c < 3; c++) {
+          average[sub][c] += pixels[(y * 4 + x) * 4 + c];
+        }
+      }
+    }
+
+    // 5 bit base colors, only valid when the delta fits in 3 bits
+    int q5[2][3];
+    bool canDiff = true;
+    for (int c = 0; c < 3; c++) {
+      q5[0][c] = std::clamp((average[0][c] / 8 * 31 + 127) / 255, 0, 31);
+      q5[1][c] = std::clamp((average[1][c] / 8 * 31 + 127) / 255, 0, 31);
+      const int delta = q5[1][c] - q5[0][c];
+      canDiff = canDiff && delta >= -4 && delta <= 3;
+    }
+
+    for (int diff = 0; diff < 2; diff++) {
+      if (diff && !canDiff) {
+        continue;
+      }
+      int base[2][3];
+      uint64_t block = ((uint64_t)diff << 33) | ((uint64_t)flip << 32);
+      if (diff) {
+        for (int c = 0; c < 3; c++) {
+          base[0][c] = extend5(q5[0][c]);
+          base[1][c] = extend5(q5[1][c]);
+          const int shift = 59 - c * 8;
+          block |= (uint64_t)q5[0][c] << shift;
+          block |= (uint64_t)((q5[1][c] - q5[0][c]) & 7) << (shift - 3);
+        }
+      } else {
+        for (int sub = 0; sub < 2; sub++) {
+          for (int c = 0; c < 3; c++) {
+            const int q4 =
+                std::clamp((average[sub][c] / 8 * 15 + 127) / 255, 0, 15);
+            base[sub][c] = extend4(q4);
+            block |= (uint64_t)q4 << (60 - c * 8 - sub * 4);
+          }
+        }
+      }
+
+      int error0, error1;
+      const int table0 = bestTable(pixels, base[0], flip, 0, &error0);
+      const int table1 = bestTable(pixels, base[1], flip, 1, &error1);
+      if (error0 + error1 >= bestError) {
+        continue;
+      }
+      block |= (uint64_t)table0 << 37;
+      block |= (uint64_t)table1 << 34;
+      fitSubBlock(pixels, base[0], table0, flip, 0, &block);
+      fitSubBlock(pixels, base[1], table1, flip, 1, &block);
+      bestError = error0 + error1;
+      bestBlock = block;
+    }
+  }
+  return bestBlock;
+}
+
+static uint64_t encodeAlpha(const uint8_t *pixels) {
+  int minAlpha = 255, maxAlpha = 0;
+  for (int i = 0; i < 16; i++) {
+    minAlpha = std::min<int>(minAlpha, pixels[i * 4 + 3]);
+    maxAlpha = std::max<int>(maxAlpha, pixels[i * 4 + 3]);
+  }
+
+  int bestError = INT_MAX, bestBase = minAlpha, bestMultiplier = 1;
+  int bestTableIndex = 13;
+  if (minAlpha != maxAlpha) {
+    for (int table = 0; table < 16 && bestError > 0; table++) {
+      const int *modifiers = eacModifiers[table];
+      const int low = *std::min_element(modifiers, modifiers + 8);
+      const int high = *std::max_element(modifiers, modifiers + 8);
+      for (int multiplier = 1; multiplier < 16; multiplier++) {
+        // center the table on the alpha range
+        const int base = clamp255(
+            (minAlpha + maxAlpha - (low + high) * multiplier + 1) / 2);
+        int error = 0;
+        for (int i = 0; i < 16 && error < bestError; i++) {
+          int best = INT_MAX;
+          for (int index = 0; index < 8; index++) {
+            const int d = clamp255(base + modifiers[index] * multiplier) -
+                          pixels[i * 4 + 3];
+            best = std::min(best, d * d);
+          }
+          error += best;
+        }
+        if (error < bestError) {
+          bestError = error;
+          bestBase = base;
+          bestMultiplier = multiplier;
+          bestTableIndex = table;
+        }
+      }
+    }
+  }
+
+  // a constant block uses table 13, which has a zero modifier
+  uint64_t block = ((uint64_t)bestBase << 56) |
+                   ((uint64_t)bestMultiplier << 52) |
+                   ((uint64_t)bestTableIndex << 48);
+  const int *modifiers = eacModifiers[bestTableIndex];
+  for (int x = 0; x < 4; x++) {
+    for (int y = 0; y < 4; y++) {
+      const int i = x * 4 + y;
+      const int alpha = pixels[(y * 4 + x) * 4 + 3];
+      int best = INT_MAX, bestIndex = 0;
+      for (int index = 0; index < 8; index++) {
+        const int d =
+            clamp255(bestBase + modifiers[index] * bestMultiplier) - alpha;
+        if (d * d < best) {
+          best = d * d;
+          bestIndex = index;
+        }
+      }
+      block |= (uint64_t)bestIndex << (45 - i * 3);
+    }
+  }
+  return block;
+}
+
+void EncodeETC2Block(const uint8_t *pixels, uint8_t *block) {
+  writeBlock(encodeAlpha(pixels), block);
+  writeBlock(encodeColor(pixels), block + 8);
+}
+
+void DecodeETC2Image(const uint8_t *blocks, int w, int h, uint8_t *out) {
+  uint8_t pixels[16 * 4];
+  for (int by = 0; by < h; by += 4) {
+    for (int bx = 0; bx < w; bx += 4) {
+      DecodeETC2Block(blocks, pixels);
+      blocks += ETC2_BLOCK_SIZE;
+      for (int y = 0; y < 4 && by + y < h; y++) {
+        const int count = std::min(4, w - bx);
+        memcpy(&out[((size_t)(by + y) * w + bx) * 4], &pixels[y * 16],
+               count * 4);
+      }
+    }
+  }
+}
+
+void EncodeETC2Image(const uint8_t *pixels, int w, int h, uint8_t *out) {
+  uint8_t block[16 * 4];
+  for (int by = 0; by < h; by += 4) {
+    for (int bx = 0; bx < w; bx += 4) {
+      for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+          const int sx = std::min(bx + x, w - 1);
+          const int sy = std::min(by + y, h - 1);
+          memcpy(&block[(y * 4 + x) * 4], &pixels[((size_t)sy * w + sx) * 4],
+                 4);
+        }
+      }
+      EncodeETC2Block(block, out);
+      out += ETC2_BLOCK_SIZE;
+    }
+  }
+}
@@ -1,191 +1,356 @@
 #include "font.hpp"
+#include "sdf.hpp"
 #include <SDL.h>
+#include <archive.hpp>
+
+#include FT_MODULE_H
+
+// the sdf renderer module arrived in freetype 2.11, older builds (the
+// emscripten port) generate the field from the coverage bitmap instead
+#if FREETYPE_MAJOR * 100 + FREETYPE_MINOR >= 211
+#define FONT_FREETYPE_SDF 1
+#endif
+
+// decodes one codepoint and advances text past it, malformed sequences decode
+// to the replacement character
+static uint32_t decodeUTF8(const char *&text) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(text);
+  uint32_t codepoint;
+  int length;
+  if (bytes[0] < 0x80) {
+    codepoint = bytes[0];
+    length = 1;
+  } else if ((bytes[0] & 0xE0) == 0xC0) {
+    codepoint = bytes[0] & 0x1F;
+    length = 2;
+  } else if ((bytes[0] & 0xF0) == 0xE0) {
+    codepoint = bytes[0] & 0x0F;
+    length = 3;
+  } else if ((bytes[0] & 0xF8) == 0xF0) {
+    codepoint = bytes[0] & 0x07;
+    length = 4;
+  } else {
+    text++;
+    return UNICODE_REPLACEMENT;
+  }
+
+  // a missing continuation byte (including the terminator) ends the sequence
+  for (int i = 1; i < length; i++) {
+    if ((bytes[i] & 0xC0) != 0x80) {
+      text += i;
+      return UNICODE_REPLACEMENT;
+    }
+    codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+  }
+  text += length;
 
-Font::Font(const char *path, int size) {
+  // reject overlong encodings, surrogates and anything past the last plane
+  static const uint32_t minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+  if (codepoint < minimum[length] || codepoint > 0x10FFFF ||
+      (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+    return UNICODE_REPLACEMENT;
+  }
+  return codepoint;
+}
+
+FontFace::~FontFace() {
+  if (this->face != nullptr && FT_Done_Face(this->face)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not close font face");
+  }
+  if (this->library != nullptr && FT_Done_FreeType(this->library)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not close freetype");
+  }
+}
 
-  this->fontSize = size;
+// each font owns its freetype library so faces can be opened on any worker
+static bool openFace(AssetBlob file, int size, FontMode mode,
+                     FontData *out) {
+  out->fontSize = size;
+  out->mode = mode;
+  out->face.reset();
 
-  SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Loading font %s %i", path,
-              this->fontSize);
+  std::shared_ptr<FontFace> face = std::make_shared<FontFace>();
+  face->file = std::move(file);
 
-  // @Todo, we should keep this arround for additional fonts refactor later
-  FT_Library ft;
-  if (FT_Init_FreeType(&ft)) {
+  if (FT_Init_FreeType(&face->library)) {
+    face->library = nullptr;
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not init freetype");
-    return;
+    return false;
   }
 
+#ifdef FONT_FREETYPE_SDF
+  FT_Int spread = FONT_SDF_SPREAD;
+  FT_Property_Set(face->library, "sdf", "spread", &spread);
+#endif
+
   // Load font as face
-  FT_Face face;
-  if (FT_New_Face(ft, path, 0, &face)) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not open font %s", path);
-    return;
+  const std::span<const uint8_t> data = face->file.data;
+  if (data.empty() || FT_New_Memory_Face(face->library, data.data(),
+                                         data.size(), 0, &face->face)) {
+    face->face = nullptr;
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not open font face");
+    return false;
   }
 
   // Set size to load glyphs as
-  if (FT_Set_Pixel_Sizes(face, 0, this->fontSize)) {
+  if (FT_Set_Pixel_Sizes(face->face, 0, size)) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not set font size");
-    return;
+    return false;
   }
 
-  const int padding = 2;
-  int row = 0;
-  int col = padding;
+  const FT_Size_Metrics &metrics = face->face->size->metrics;
+  out->maxHeight = (metrics.ascender - metrics.descender) >> 6;
+  out->face = std::move(face);
+  return true;
+}
 
-  std::vector<char> texData(this->texDim * this->texDim * 4, 0);
+Font::Font(const char *path, int size, FontMode mode) {
+  FontData data;
+  Decode(path, size, &data, mode);
+  this->init(data);
+}
 
-  // Load glyphs from the ASCII set (ASCII 32 - 126)
-  for (FT_ULong ascii = ASCII_OFFSET; ascii <= ASCII_EXTENDED_MAX; ++ascii) {
-    FT_UInt glyph_index = FT_Get_Char_Index(face, ascii);
-    if (FT_Load_Glyph(face, glyph_index, FT_LOAD_DEFAULT)) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not load glyph %c",
-                   (char)ascii);
-      continue;
-    }
-    if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL)) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not render glyph %c",
-                   (char)ascii);
-      continue;
-    }
+Font::Font(std::span<const uint8_t> data, int size, FontMode mode) {
+  FontData fontData;
+  Decode(data, size, &fontData, mode);
+  this->init(fontData);
+}
 
-    if (col + face->glyph->bitmap.width + padding >= this->texDim) {
-      // Reached bottom of texture, move to next column
-      col = padding;
-      row += this->fontSize;
-    }
+Font::Font(FontData data) { this->init(data); }
 
-    this->max_height = std::max(
-        (face->size->metrics.ascender - face->size->metrics.descender) >> 6,
-        this->max_height);
-
-    for (uint y = 0; y < face->glyph->bitmap.rows; ++y) {
-      for (uint x = 0; x < face->glyph->bitmap.width; ++x) {
-        // if we are out of bounds, break
-        if (col + x >= this->texDim || row + y >= this->texDim) {
-          SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                       "Out of bounds on glyph %c, (%i, %i)", (char)ascii,
-                       col + x, row + y);
-          break;
-        }
+bool Font::Decode(const char *path, int size, FontData *out, FontMode mode) {
+  SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Loading font %s %i", path, size);
 
-        const auto val =
-            face->glyph->bitmap.buffer[y * face->glyph->bitmap.width + x];
-        // set rgba
-        texData[4 * (this->texDim * (row + y) + (col + x)) + 0] = val;
-        texData[4 * (this->texDim * (row + y) + (col + x)) + 1] = val;
-        texData[4 * (this->texDim * (row + y) + (col + x)) + 2] = val;
-        texData[4 * (this->texDim * (row + y) + (col + x)) + 3] = val;
-      }
-    }
+  // the face reads from the blob, it is kept alive with the face
+  AssetBlob blob;
+  if (!AssetArchive::Open(path, &blob)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not open font %s", path);
+  }
+  return openFace(std::move(blob), size, mode, out);
+}
 
-    const Glyph g = {.offset = glm::vec2((float)face->glyph->bitmap_left,
-                                         (float)face->glyph->bitmap_top),
-                     .size = glm::ivec2((int)face->glyph->bitmap.width,
-                                        (int)face->glyph->bitmap.rows),
-                     .texCoords = glm::ivec2(col, row),
-                     .advance =
-                         glm::vec2((float)(face->glyph->advance.x >> 6),
-                                   (float)(face->glyph->advance.y >> 6))};
+bool Font::Decode(std::span<const uint8_t> data, int size, FontData *out,
+                  FontMode mode) {
+  AssetBlob blob;
+  blob.data = data;
+  return openFace(std::move(blob), size, mode, out);
+}
 
-    const auto p = std::make_pair((char)ascii, g);
+void Font::init(FontData &data) {
+  this->fontSize = data.fontSize;
+  this->max_height = data.maxHeight;
+  this->mode = data.mode;
+  this->face = std::move(data.face);
 
-    this->glyphs.insert(p);
+  // pages are shared with every other font, nothing is rasterized up front
+  this->cache = GlyphCache::GetShared(this->mode == FontMode::SDF);
+}
 
-    col += face->glyph->bitmap.width + padding;
+const Glyph *Font::getGlyph(uint32_t codepoint) {
+  if (codepoint < FONT_DENSE_GLYPHS) {
+    if (this->denseLoaded[codepoint]) {
+      return &this->denseGlyphs[codepoint];
+    }
+  } else {
+    const auto found = this->sparseGlyphs.find(codepoint);
+    if (found != this->sparseGlyphs.end()) {
+      return &found->second;
+    }
+  }
+  if (!this->face) {
+    return nullptr;
   }
 
-  if (FT_Done_Face(face)) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not close font %s", path);
-    return;
+  // codepoints missing from the face render the face's notdef glyph
+  FT_Face face = this->face->face;
+  FT_Render_Mode renderMode = FT_RENDER_MODE_NORMAL;
+#ifdef FONT_FREETYPE_SDF
+  if (this->mode == FontMode::SDF) {
+    renderMode = FT_RENDER_MODE_SDF;
   }
-  if (FT_Done_FreeType(ft)) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not close freetype");
-    return;
+#endif
+  // empty outlines (spaces) are not rendered, the sdf renderer rejects them
+  FT_GlyphSlot slot = nullptr;
+  if (!FT_Load_Char(face, codepoint, FT_LOAD_DEFAULT)) {
+    slot = face->glyph;
+  }
+  if (slot == nullptr || (slot->format == FT_GLYPH_FORMAT_OUTLINE &&
+                          slot->outline.n_points > 0 &&
+                          FT_Render_Glyph(slot, renderMode))) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not render glyph U+%04X",
+                 codepoint);
+    return this->cacheGlyph(codepoint, Glyph{});
   }
 
-  // Upload texture to GPU
-  glGenTextures(1, &this->tex);
-  glBindTexture(GL_TEXTURE_2D, this->tex);
-
-  // Set texture options
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  const FT_Bitmap &bitmap = slot->bitmap;
+  const uint8_t *pixels = bitmap.buffer;
+  int w = bitmap.width;
+  int h = bitmap.rows;
+  int pitch = bitmap.pitch;
+  glm::vec2 offset((float)slot->bitmap_left, (float)slot->bitmap_top);
+
+#ifndef FONT_FREETYPE_SDF
+  std::vector<uint8_t> field;
+  if (this->mode == FontMode::SDF && w > 0 && h > 0) {
+    GenerateSDF(pixels, w, h, pitch, FONT_SDF_SPREAD, &field);
+    pixels = field.data();
+    w += FONT_SDF_SPREAD * 2;
+    h += FONT_SDF_SPREAD * 2;
+    pitch = w;
+    offset += glm::vec2(-FONT_SDF_SPREAD, FONT_SDF_SPREAD);
+  }
+#endif
+
+  Glyph g = {.offset = offset,
+             .size = glm::ivec2(w, h),
+             .texCoords = glm::ivec2(0, 0),
+             .advance = glm::vec2((float)(slot->advance.x >> 6),
+                                  (float)(slot->advance.y >> 6)),
+             .texture = 0};
+
+  if (w > 0 && h > 0) {
+    GlyphSlot placed;
+    if (!this->cache->Insert(pixels, w, h, pitch, &placed)) {
+      // pages are never freed, so it would not fit next time either
+      return this->cacheGlyph(codepoint, Glyph{});
+    }
+    g.texCoords = placed.position;
+    g.texture = placed.texture;
+    this->gpuBytes += (size_t)(w + GLYPH_CACHE_PADDING * 2) *
+                      (h + GLYPH_CACHE_PADDING * 2);
+  }
 
-  // @TODO: make shader work with red on black
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, this->texDim, this->texDim, 0,
-               GL_RGBA, GL_UNSIGNED_BYTE, &texData[0]);
+  return this->cacheGlyph(codepoint, g);
 }
 
-void Font::RenderText(SpriteBatch *renderer, const char *text,
-                      glm::vec2 position, glm::vec2 scale, glm::vec4 color,
-                      glm::vec2 *outDims, float wrapWidth) {
-  glBindTexture(GL_TEXTURE_2D, this->tex);
-
-  renderer->SetTextureAndDimensions(this->tex, this->texDim, this->texDim);
+const Glyph *Font::cacheGlyph(uint32_t codepoint, const Glyph &glyph) {
+  if (codepoint < FONT_DENSE_GLYPHS) {
+    this->denseLoaded[codepoint] = true;
+    return &(this->denseGlyphs[codepoint] = glyph);
+  }
+  return &(this->sparseGlyphs[codepoint] = glyph);
+}
 
+template <typename Emit>
+glm::vec2 Font::layout(const char *text, glm::vec2 position, glm::vec2 scale,
+                       float wrapWidth, Emit emit) {
   const auto startY = position.y;
   const auto startX = position.x;
 
   // add the fontsize * 2 to the y position, the top left is the anchor point
-  position.y += this->fontSize;
+  const float lineHeight = this->fontSize * scale.y;
+  position.y += lineHeight;
 
   float currentWidth = 0;
 
-  for (int i = 0; i < strlen(text); i++) {
-    Glyph *g = &this->glyphs.at(text[i]);
+  for (const char *cursor = text; *cursor != '\0';) {
+    const uint32_t codepoint = decodeUTF8(cursor);
+    const Glyph *g = this->getGlyph(codepoint);
     if (g == nullptr) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not find glyph %c",
-                   text[i]);
       continue;
     }
 
-    const glm::vec4 srcRect =
-        glm::vec4(g->texCoords.x, g->texCoords.y, g->size.x, g->size.y);
-
-    const auto adjustedPosition = glm::vec2(position.x + g->offset.x * scale.x,
-                                            position.y - g->offset.y * scale.y);
-
-    renderer->Draw(this->tex, adjustedPosition, scale, 0.0f, color, srcRect);
+    // glyphs without pixels only advance the pen
+    if (g->texture != 0) {
+      emit(*g, glm::vec2(position.x + g->offset.x * scale.x,
+                         position.y - g->offset.y * scale.y));
+    }
 
     position.x += g->advance.x * scale.x;
 
     currentWidth += g->advance.x * scale.x;
 
     if (wrapWidth >= 0 && currentWidth > wrapWidth) {
-      position.y += this->fontSize * 1.5f;
+      position.y += lineHeight * 1.5f;
       position.x = startX;
       currentWidth = 0;
     }
   }
 
-  if (outDims != nullptr) {
+  // if no text length is 0
+  if (text[0] == '\0') {
+    return glm::vec2(0, 0);
+  }
 
-    int w;
-    if (wrapWidth <= 0) {
-      w = currentWidth;
-    } else {
-      w = wrapWidth;
-    }
+  int w;
+  if (wrapWidth <= 0) {
+    w = currentWidth;
+  } else {
+    w = wrapWidth;
+  }
+  return glm::vec2(w + lineHeight, position.y - startY + lineHeight);
+}
 
-    // if no text length is 0
-    if (strlen(text) == 0) {
-      *outDims = glm::vec2(0, 0);
-      return;
-    }
+uint8_t Font::getPageFlags() const {
+  return this->mode == FontMode::SDF ? SPRITE_BATCH_SDF_TEXTURE
+                                     : SPRITE_BATCH_ALPHA_TEXTURE;
+}
 
-    *outDims = glm::vec2(w + fontSize, position.y - startY + fontSize);
+void Font::RenderText(SpriteBatch *renderer, const char *text,
+                      glm::vec2 position, glm::vec2 scale, glm::vec4 color,
+                      glm::vec2 *outDims, float wrapWidth) {
+  const int pageDim = this->cache->GetPageDim();
+  const uint8_t pageFlags = this->getPageFlags();
+  GLuint page = 0;
+
+  const glm::vec2 dims = this->layout(
+      text, position, scale, wrapWidth,
+      [&](const Glyph &g, glm::vec2 glyphPosition) {
+        if (g.texture != page) {
+          page = g.texture;
+          renderer->SetTextureAndDimensions(page, pageDim, pageDim, pageFlags);
+        }
+
+        const glm::vec4 srcRect =
+            glm::vec4(g.texCoords.x, g.texCoords.y, g.size.x, g.size.y);
+        renderer->Draw(page, glyphPosition, scale, 0.0f, color, srcRect);
+      });
+
+  if (outDims != nullptr) {
+    *outDims = dims;
   }
 }
 
+glm::vec2 Font::BuildText(const char *text, glm::vec2 position,
+                          glm::vec2 scale, glm::vec4 color, float wrapWidth,
+                          std::vector<Vertex> *vertices,
+                          std::vector<TextRun> *runs) {
+  const float pageDim = this->cache->GetPageDim();
+  const uint8_t pageFlags = this->getPageFlags();
+
+  return this->layout(
+      text, position, scale, wrapWidth,
+      [&](const Glyph &g, glm::vec2 topLeft) {
+        // consecutive glyphs on the same page share a run
+        if (runs->empty() || runs->back().texture != g.texture) {
+          runs->push_back({g.texture, pageFlags, vertices->size(), 0});
+        }
+        runs->back().count += 4;
+
+        const glm::vec2 size = glm::vec2(g.size) * scale;
+        const glm::vec2 uvTopLeft = glm::vec2(g.texCoords) / pageDim;
+        const glm::vec2 uvBottomRight =
+            glm::vec2(g.texCoords + g.size) / pageDim;
+
+        // same corner order as SpriteBatch::Draw, the slot is filled in when
+        // the run is appended to a batch
+        vertices->push_back(Vertex(topLeft, uvTopLeft, color, 0));
+        vertices->push_back(Vertex(topLeft + glm::vec2(size.x, 0),
+                                   glm::vec2(uvBottomRight.x, uvTopLeft.y),
+                                   color, 0));
+        vertices->push_back(Vertex(topLeft + glm::vec2(0, size.y),
+                                   glm::vec2(uvTopLeft.x, uvBottomRight.y),
+                                   color, 0));
+        vertices->push_back(
+            Vertex(topLeft + size, uvBottomRight, color, 0));
+      });
+}
+
 glm::vec2 Font::GetTextDimensions(const char *text) {
   glm::vec2 dimensions = glm::vec2(0, 0);
-  for (int i = 0; i < strlen(text); i++) {
-    Glyph *g = &this->glyphs.at(text[i]);
+  for (const char *cursor = text; *cursor != '\0';) {
+    const Glyph *g = this->getGlyph(decodeUTF8(cursor));
     if (g == nullptr) {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not find glyph %c",
-                   text[i]);
       continue;
     }
 
@@ -0,0 +1,50 @@
+#include "frame-graph.hpp"
+
+#include <profiler.hpp>
+
+#define FRAME_GRAPH_60FPS_MS (1000.0f / 60.0f)
+#define FRAME_GRAPH_30FPS_MS (1000.0f / 30.0f)
+
+void DrawFrameGraph(SpriteBatch *spriteBatch, glm::vec2 position,
+                    glm::vec2 size) {
+  ProfileFrame frames[PROFILER_FRAME_HISTORY];
+  const size_t count = Profiler::GetFrames(frames, PROFILER_FRAME_HISTORY);
+
+  spriteBatch->DrawRect(glm::vec4(position.x, position.y, size.x, size.y),
+                        glm::vec4(0, 0, 0, 0.5f));
+
+  const float barWidth = size.x / PROFILER_FRAME_HISTORY;
+  const float bottom = position.y + size.y;
+  const auto barHeight = [&](float ms) {
+    return glm::min(ms, FRAME_GRAPH_MAX_MS) / FRAME_GRAPH_MAX_MS * size.y;
+  };
+
+  // newest frame on the right
+  float x = position.x + (PROFILER_FRAME_HISTORY - count) * barWidth;
+  for (size_t i = 0; i < count; i++, x += barWidth) {
+    const ProfileFrame &frame = frames[i];
+    glm::vec4 color(0.2f, 0.9f, 0.2f, 0.8f);
+    if (frame.cpuMs > FRAME_GRAPH_30FPS_MS) {
+      color = glm::vec4(0.9f, 0.2f, 0.2f, 0.8f);
+    } else if (frame.cpuMs > FRAME_GRAPH_60FPS_MS) {
+      color = glm::vec4(0.9f, 0.9f, 0.2f, 0.8f);
+    }
+    const float cpuHeight = barHeight(frame.cpuMs);
+    spriteBatch->DrawRect(
+        glm::vec4(x, bottom - cpuHeight, barWidth, cpuHeight), color);
+
+    if (frame.gpuMs > 0.0f) {
+      const float gpuHeight = barHeight(frame.gpuMs);
+      spriteBatch->DrawRect(
+          glm::vec4(x, bottom - gpuHeight, barWidth * 0.5f, gpuHeight),
+          glm::vec4(0.3f, 0.5f, 1.0f, 0.8f));
+    }
+  }
+
+  // budget lines
+  for (const float ms : {FRAME_GRAPH_60FPS_MS, FRAME_GRAPH_30FPS_MS}) {
+    spriteBatch->DrawRect(
+        glm::vec4(position.x, bottom - barHeight(ms), size.x, 1.0f),
+        glm::vec4(1, 1, 1, 0.5f));
+  }
+}
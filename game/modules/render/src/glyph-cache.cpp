@@ -0,0 +1,138 @@
+#include "glyph-cache.hpp"
+#include "render-thread.hpp"
+
+#include <SDL.h>
+#include <cstring>
+
+// only touched on the recording thread, no locking needed
+static std::weak_ptr<GlyphCache> sharedCaches[2];
+
+GlyphCache::GlyphCache() {}
+
+GlyphCache::~GlyphCache() {
+  for (Page &page : this->pages) {
+    RenderThread::Submit(
+        [texture = page.texture]() { glDeleteTextures(1, &texture); });
+  }
+}
+
+std::shared_ptr<GlyphCache> GlyphCache::GetShared(bool distanceField) {
+  std::shared_ptr<GlyphCache> cache = sharedCaches[distanceField].lock();
+  if (!cache) {
+    cache = std::make_shared<GlyphCache>();
+    sharedCaches[distanceField] = cache;
+  }
+  return cache;
+}
+
+size_t GlyphCache::GetSharedGPUBytes() {
+  size_t bytes = 0;
+  for (const std::weak_ptr<GlyphCache> &weak : sharedCaches) {
+    if (const std::shared_ptr<GlyphCache> cache = weak.lock()) {
+      bytes += cache->GetGPUBytes();
+    }
+  }
+  return bytes;
+}
+
+bool GlyphCache::Insert(const uint8_t *pixels, int w, int h, int pitch,
+                        GlyphSlot *out) {
+  const int paddedW = w + GLYPH_CACHE_PADDING * 2;
+  const int paddedH = h + GLYPH_CACHE_PADDING * 2;
+  if (paddedW > GLYPH_CACHE_PAGE_DIM || paddedH > GLYPH_CACHE_PAGE_DIM) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "GlyphCache: glyph %ix%i does not fit in a page", w, h);
+    return false;
+  }
+
+  // try the existing pages first
+  glm::ivec2 position;
+  Page *target = nullptr;
+  for (Page &page : this->pages) {
+    if (this->allocate(page, paddedW, paddedH, &position)) {
+      target = &page;
+      break;
+    }
+  }
+  if (target == nullptr) {
+    if (this->pages.size() == GLYPH_CACHE_MAX_PAGES) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                   "GlyphCache: all %i pages full", GLYPH_CACHE_MAX_PAGES);
+      return false;
+    }
+    this->addPage();
+    target = &this->pages.back();
+    if (!this->allocate(*target, paddedW, paddedH, &position)) {
+      return false;
+    }
+  }
+
+  // upload the glyph with its zeroed border in one call
+  this->staging.assign((size_t)paddedW * paddedH, 0);
+  for (int y = 0; y < h; y++) {
+    memcpy(&this->staging[(size_t)(y + GLYPH_CACHE_PADDING) * paddedW +
+                          GLYPH_CACHE_PADDING],
+           pixels + (size_t)y * pitch, w);
+  }
+
+  // ordered before any draw that samples the glyph
+  RenderThread::Submit([texture = target->texture, position, paddedW, paddedH,
+                        pixels = this->staging]() {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, position.x, position.y, paddedW,
+                    paddedH, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  });
+
+  out->texture = target->texture;
+  out->position = position + glm::ivec2(GLYPH_CACHE_PADDING);
+  return true;
+}
+
+bool GlyphCache::allocate(Page &page, int w, int h, glm::ivec2 *out) {
+  // best fitting shelf that is not much taller than the glyph, so shelves of
+  // small glyphs are not wasted on large ones
+  Shelf *best = nullptr;
+  for (Shelf &shelf : page.shelves) {
+    if (shelf.height >= h && shelf.height <= h + h / 2 + 2 &&
+        shelf.cursor + w <= GLYPH_CACHE_PAGE_DIM &&
+        (best == nullptr || shelf.height < best->height)) {
+      best = &shelf;
+    }
+  }
+
+  if (best == nullptr) {
+    if (page.top + h > GLYPH_CACHE_PAGE_DIM) {
+      return false;
+    }
+    page.shelves.push_back({page.top, h, 0});
+    page.top += h;
+    best = &page.shelves.back();
+  }
+
+  *out = glm::ivec2(best->cursor, best->y);
+  best->cursor += w;
+  return true;
+}
+
+void GlyphCache::addPage() {
+  Page page = {};
+  RenderThread::Call([&page]() {
+    glGenTextures(1, &page.texture);
+    glBindTexture(GL_TEXTURE_2D, page.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, GLYPH_CACHE_PAGE_DIM,
+                 GLYPH_CACHE_PAGE_DIM, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // single level, keeps the page complete under the sprite batch sampler
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  });
+
+  this->pages.push_back(page);
+  SDL_Log("GlyphCache: added page %zu", this->pages.size());
+}
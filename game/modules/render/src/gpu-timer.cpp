@@ -0,0 +1,86 @@
+#include "gpu-timer.hpp"
+
+#include <SDL.h>
+#include <cstring>
+#include <profiler.hpp>
+
+static bool hasExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (extension != nullptr && strcmp(extension, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+GpuTimer::GpuTimer() {
+  this->supported = hasExtension("GL_EXT_disjoint_timer_query") ||
+                    hasExtension("GL_EXT_disjoint_timer_query_webgl2") ||
+                    hasExtension("GL_ARB_timer_query");
+  if (!this->supported) {
+    SDL_Log("GpuTimer: no timer queries, GPU frame times are unavailable");
+    return;
+  }
+  glGenQueries(GPU_TIMER_QUERIES, this->queries);
+}
+
+GpuTimer::~GpuTimer() {
+  if (this->supported) {
+    glDeleteQueries(GPU_TIMER_QUERIES, this->queries);
+  }
+}
+
+void GpuTimer::BeginFrame(uint64_t frame) {
+  // every query is still in flight, skip timing this frame
+  if (!this->supported || this->active || this->pending[this->next]) {
+    return;
+  }
+  glBeginQuery(GL_TIME_ELAPSED_EXT, this->queries[this->next]);
+  this->frames[this->next] = frame;
+  this->active = true;
+}
+
+void GpuTimer::EndFrame() {
+  if (!this->active) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED_EXT);
+  this->pending[this->next] = true;
+  this->next = (this->next + 1) % GPU_TIMER_QUERIES;
+  this->active = false;
+}
+
+void GpuTimer::Collect() {
+  if (!this->supported) {
+    return;
+  }
+
+  // a disjoint event (power state or clock change) invalidates everything in
+  // flight, only reported by the EXT
+  GLint disjoint = 0;
+  if (GLAD_GL_EXT_disjoint_timer_query) {
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  }
+
+  for (size_t i = 0; i < GPU_TIMER_QUERIES; i++) {
+    if (!this->pending[i]) {
+      continue;
+    }
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(this->queries[i], GL_QUERY_RESULT_AVAILABLE,
+                        &available);
+    if (!available) {
+      continue;
+    }
+    // nanoseconds, 32 bits cover frames up to 4 seconds
+    GLuint elapsed = 0;
+    glGetQueryObjectuiv(this->queries[i], GL_QUERY_RESULT, &elapsed);
+    this->pending[i] = false;
+    if (!disjoint) {
+      Profiler::SetGpuTime(this->frames[i], elapsed / 1e6f);
+    }
+  }
+}
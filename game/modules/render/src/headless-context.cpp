@@ -0,0 +1,151 @@
+#include "headless-context.hpp"
+
+#include <SDL.h>
+#include <glad/glad.h>
+
+#ifdef RENDER_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+HeadlessContext::HeadlessContext(int width, int height) {
+  // prefer the surfaceless platform, it works without a gpu or display server
+  EGLDisplay display = EGL_NO_DISPLAY;
+  const auto getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+          "eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay != nullptr) {
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                 EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "HeadlessContext: could not initialize EGL");
+    return;
+  }
+  this->display = display;
+
+  // surfaceless displays only expose pbuffer configs
+  const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                     EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+                                     EGL_NONE};
+  EGLConfig config;
+  EGLint numConfigs = 0;
+  if (!eglBindAPI(EGL_OPENGL_ES_API) ||
+      !eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) ||
+      numConfigs == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "HeadlessContext: no GLES3 config");
+    return;
+  }
+
+  const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 3,
+                                      EGL_CONTEXT_MINOR_VERSION, 0, EGL_NONE};
+  EGLContext context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+  if (context == EGL_NO_CONTEXT) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "HeadlessContext: could not create context: 0x%x",
+                 eglGetError());
+    return;
+  }
+  this->context = context;
+
+  // without EGL_KHR_surfaceless_context a pbuffer has to be current, it is
+  // never drawn to
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    const EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    this->surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+    if (this->surface == EGL_NO_SURFACE ||
+        !eglMakeCurrent(display, this->surface, this->surface, context)) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                   "HeadlessContext: could not make context current: 0x%x",
+                   eglGetError());
+      return;
+    }
+  }
+
+  if (!gladLoadGLES2Loader((GLADloadproc)HeadlessContext::GetProcAddress)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "HeadlessContext: could not load GLES3");
+    return;
+  }
+  SDL_Log("HeadlessContext: %s", glGetString(GL_RENDERER));
+
+  // surfaceless contexts have no default framebuffer, this one stays bound
+  glGenRenderbuffers(1, &this->colorbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, this->colorbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glGenRenderbuffers(1, &this->depthbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, this->depthbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &this->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, this->colorbuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, this->depthbuffer);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "HeadlessContext: framebuffer incomplete");
+    return;
+  }
+  glViewport(0, 0, width, height);
+
+  this->valid = true;
+}
+
+HeadlessContext::~HeadlessContext() {
+  if (this->framebuffer != 0) {
+    glDeleteFramebuffers(1, &this->framebuffer);
+    glDeleteRenderbuffers(1, &this->colorbuffer);
+    glDeleteRenderbuffers(1, &this->depthbuffer);
+  }
+  if (this->display != nullptr) {
+    eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                   EGL_NO_CONTEXT);
+    if (this->surface != nullptr) {
+      eglDestroySurface(this->display, this->surface);
+    }
+    if (this->context != nullptr) {
+      eglDestroyContext(this->display, this->context);
+    }
+    eglTerminate(this->display);
+  }
+}
+
+void HeadlessContext::MakeCurrent() {
+  eglMakeCurrent(this->display, this->surface, this->surface, this->context);
+}
+
+void HeadlessContext::Release() {
+  eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                 EGL_NO_CONTEXT);
+}
+
+void *HeadlessContext::GetProcAddress(const char *name) {
+  return (void *)eglGetProcAddress(name);
+}
+#else
+HeadlessContext::HeadlessContext(int width, int height) {
+  (void)width;
+  (void)height;
+  SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+               "HeadlessContext: built without EGL");
+}
+
+HeadlessContext::~HeadlessContext() {}
+
+void HeadlessContext::MakeCurrent() {}
+
+void HeadlessContext::Release() {}
+
+void *HeadlessContext::GetProcAddress(const char *name) {
+  (void)name;
+  return nullptr;
+}
+#endif
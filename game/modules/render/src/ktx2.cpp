@@ -0,0 +1,217 @@
+#include "ktx2.hpp"
+#include "etc2.hpp"
+
+#include <SDL.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const uint8_t ktx2Identifier[12] = {0xAB, 0x4B, 0x54, 0x58,
+                                           0x20, 0x32, 0x30, 0xBB,
+                                           0x0D, 0x0A, 0x1A, 0x0A};
+
+// level data alignment, lcm of the block size and 4
+#define KTX2_LEVEL_ALIGNMENT 16
+
+// data format descriptor constants for ETC2 RGBA8
+#define KHR_DF_MODEL_ETC2 161
+#define KHR_DF_CHANNEL_ETC2_COLOR 2
+#define KHR_DF_CHANNEL_ETC2_ALPHA 15
+
+struct KTX2Header {
+  uint8_t identifier[12];
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+static_assert(sizeof(KTX2Header) == 80, "KTX2 header must be packed");
+
+struct KTX2LevelIndex {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+template <typename T> static void append(std::vector<uint8_t> &out, T value) {
+  const size_t offset = out.size();
+  out.resize(offset + sizeof(T));
+  memcpy(&out[offset], &value, sizeof(T));
+}
+
+std::string GetCookedTexturePath(const std::string &sourcePath) {
+  return sourcePath.substr(0, sourcePath.find_last_of('.') + 1) +
+         KTX2_EXTENSION;
+}
+
+bool IsKTX2(std::span<const uint8_t> data) {
+  return data.size() >= sizeof(ktx2Identifier) &&
+         memcmp(data.data(), ktx2Identifier, sizeof(ktx2Identifier)) == 0;
+}
+
+bool WriteKTX2(const ImageData &image, const std::string &path) {
+  if (image.compressedFormat != GL_COMPRESSED_RGBA8_ETC2_EAC ||
+      image.levels.empty()) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "KTX2: only ETC2 RGBA8 images can be written");
+    return false;
+  }
+
+  // basic data format descriptor block with one sample per ETC2 half block
+  std::vector<uint8_t> dfd;
+  append<uint32_t>(dfd, 0); // total size, patched below
+  append<uint32_t>(dfd, 0); // vendor id and descriptor type
+  append<uint16_t>(dfd, 2); // version
+  append<uint16_t>(dfd, 24 + 16 * 2);
+  dfd.push_back(KHR_DF_MODEL_ETC2);
+  dfd.push_back(1); // BT709 primaries
+  dfd.push_back(1); // linear transfer
+  dfd.push_back(0); // straight alpha
+  const uint8_t blockDimensions[4] = {3, 3, 0, 0};
+  dfd.insert(dfd.end(), blockDimensions, blockDimensions + 4);
+  const uint8_t bytesPlane[8] = {ETC2_BLOCK_SIZE, 0, 0, 0, 0, 0, 0, 0};
+  dfd.insert(dfd.end(), bytesPlane, bytesPlane + 8);
+  const uint8_t channels[2] = {KHR_DF_CHANNEL_ETC2_ALPHA,
+                               KHR_DF_CHANNEL_ETC2_COLOR};
+  for (int i = 0; i < 2; i++) {
+    append<uint16_t>(dfd, i * 64); // bit offset
+    dfd.push_back(63);             // bit length - 1
+    dfd.push_back(channels[i]);
+    append<uint32_t>(dfd, 0); // sample position
+    append<uint32_t>(dfd, 0);
+    append<uint32_t>(dfd, 0xFFFFFFFF);
+  }
+  const uint32_t dfdSize = dfd.size();
+  memcpy(dfd.data(), &dfdSize, sizeof(dfdSize));
+
+  KTX2Header header = {};
+  memcpy(header.identifier, ktx2Identifier, sizeof(ktx2Identifier));
+  header.vkFormat = KTX2_VK_FORMAT_ETC2_RGBA8;
+  header.typeSize = 1;
+  header.pixelWidth = image.w;
+  header.pixelHeight = image.h;
+  header.faceCount = 1;
+  header.levelCount = image.levels.size();
+  header.dfdByteOffset =
+      sizeof(KTX2Header) + image.levels.size() * sizeof(KTX2LevelIndex);
+  header.dfdByteLength = dfd.size();
+
+  // the index lists level 0 first but the data is stored smallest level first
+  std::vector<KTX2LevelIndex> levelIndex(image.levels.size());
+  uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+  for (size_t i = image.levels.size(); i-- > 0;) {
+    offset = alignOffset(offset, KTX2_LEVEL_ALIGNMENT);
+    levelIndex[i].byteOffset = offset;
+    levelIndex[i].byteLength = image.levels[i].size;
+    levelIndex[i].uncompressedByteLength = image.levels[i].size;
+    offset += image.levels[i].size;
+  }
+
+  std::vector<uint8_t> blob(offset, 0);
+  memcpy(blob.data(), &header, sizeof(header));
+  memcpy(&blob[sizeof(header)], levelIndex.data(),
+         levelIndex.size() * sizeof(KTX2LevelIndex));
+  memcpy(&blob[header.dfdByteOffset], dfd.data(), dfd.size());
+  for (size_t i = 0; i < image.levels.size(); i++) {
+    memcpy(&blob[levelIndex[i].byteOffset],
+           &image.pixels[image.levels[i].offset], image.levels[i].size);
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not open %s for writing",
+                 path.c_str());
+    return false;
+  }
+  file.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+  return (bool)file;
+}
+
+bool ParseKTX2(std::span<const uint8_t> data, ImageData *out) {
+  if (!IsKTX2(data) || data.size() < sizeof(KTX2Header)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "KTX2: not a KTX2 file");
+    return false;
+  }
+
+  KTX2Header header;
+  memcpy(&header, data.data(), sizeof(header));
+  if (header.vkFormat != KTX2_VK_FORMAT_ETC2_RGBA8 ||
+      header.supercompressionScheme != 0 || header.pixelDepth > 1 ||
+      header.layerCount > 1 || header.faceCount != 1 ||
+      header.pixelWidth == 0 || header.pixelHeight == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "KTX2: unsupported format %u, only 2D ETC2 RGBA8 is read",
+                 header.vkFormat);
+    return false;
+  }
+
+  if (header.pixelWidth > KTX2_MAX_DIMENSION ||
+      header.pixelHeight > KTX2_MAX_DIMENSION) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "KTX2: %ux%u is too large",
+                 header.pixelWidth, header.pixelHeight);
+    return false;
+  }
+
+  // a level count of 0 asks for runtime generation, we never cook that. a
+  // full chain ends at 1x1, more levels than that would shift past the width
+  uint32_t maxLevels = 1;
+  while ((std::max(header.pixelWidth, header.pixelHeight) >> maxLevels) > 0) {
+    maxLevels++;
+  }
+  const uint32_t levelCount = std::max(header.levelCount, 1u);
+  if (levelCount > maxLevels) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "KTX2: %u levels for %ux%u", levelCount, header.pixelWidth,
+                 header.pixelHeight);
+    return false;
+  }
+  if (sizeof(KTX2Header) + (uint64_t)levelCount * sizeof(KTX2LevelIndex) >
+          data.size() ||
+      (uint64_t)header.kvdByteOffset + header.kvdByteLength > data.size()) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "KTX2: truncated file");
+    return false;
+  }
+
+  out->w = header.pixelWidth;
+  out->h = header.pixelHeight;
+  out->compressedFormat = GL_COMPRESSED_RGBA8_ETC2_EAC;
+  out->levels.clear();
+  out->pixels.clear();
+
+  for (uint32_t i = 0; i < levelCount; i++) {
+    KTX2LevelIndex level;
+    memcpy(&level, &data[sizeof(KTX2Header) + i * sizeof(KTX2LevelIndex)],
+           sizeof(level));
+
+    const int w = std::max(out->w >> i, 1);
+    const int h = std::max(out->h >> i, 1);
+    if (level.byteLength != GetETC2ImageSize(w, h) ||
+        level.byteOffset > data.size() ||
+        level.byteLength > data.size() - level.byteOffset) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "KTX2: bad level %u", i);
+      return false;
+    }
+
+    const size_t offset = out->pixels.size();
+    out->pixels.insert(out->pixels.end(), &data[level.byteOffset],
+                       &data[level.byteOffset] + level.byteLength);
+    out->levels.push_back({w, h, offset, (size_t)level.byteLength});
+  }
+
+  return true;
+}
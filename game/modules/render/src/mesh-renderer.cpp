@@ -1,10 +1,23 @@
 #include "mesh-renderer.hpp"
+#include "render-stats.hpp"
+#include "render-thread.hpp"
 
 #include <SDL.h>
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
+#include <profiler.hpp>
 
 MeshRenderer::MeshRenderer() {
+  RenderThread::Call([this]() { this->createGLObjects(); });
+}
+
+MeshRenderer::~MeshRenderer() {
+  // flushes still in flight draw with this renderer's program
+  RenderThread::Drain();
+  RenderThread::Call([this]() { glDeleteProgram(this->shaderProgram); });
+}
 
+void MeshRenderer::createGLObjects() {
   this->vertexShader.LoadFromFile("assets/shaders/mesh.vert", GL_VERTEX_SHADER);
   this->fragmentShader.LoadFromFile("assets/shaders/mesh.frag",
                                     GL_FRAGMENT_SHADER);
@@ -30,84 +43,338 @@ MeshRenderer::MeshRenderer() {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                  "Failed to link shader program: %s", log.c_str());
     glDeleteProgram(this->shaderProgram);
+    this->shaderProgram = 0;
     return;
   }
 
+  this->uniforms.model = glGetUniformLocation(this->shaderProgram, "model");
+  this->uniforms.view = glGetUniformLocation(this->shaderProgram, "view");
+  this->uniforms.projection =
+      glGetUniformLocation(this->shaderProgram, "projection");
+  this->uniforms.instanced =
+      glGetUniformLocation(this->shaderProgram, "instanced");
+  this->uniforms.packedNormals =
+      glGetUniformLocation(this->shaderProgram, "packedNormals");
+  this->uniforms.emissive =
+      glGetUniformLocation(this->shaderProgram, "emissive");
+
+  const GLuint materialBlockIndex =
+      glGetUniformBlockIndex(this->shaderProgram, "MaterialBlock");
+  if (materialBlockIndex != GL_INVALID_INDEX) {
+    glUniformBlockBinding(this->shaderProgram, materialBlockIndex,
+                          MATERIAL_BLOCK_BINDING);
+  }
+
   glUseProgram(this->shaderProgram);
+  RenderStats::CountProgramSwitch();
   // set mat4 view
-  GLint viewLoc = glGetUniformLocation(this->shaderProgram, "view");
-  glm::mat4 view =
+  this->view =
       glm::lookAt(glm::vec3(0.0f, 2.85f, 15.63f), glm::vec3(0.0f, 0.0f, 0.0f),
                   glm::vec3(0.0f, 1.0f, 0.0f));
-  glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+  glUniformMatrix4fv(this->uniforms.view, 1, GL_FALSE,
+                     glm::value_ptr(this->view));
   // set mat4 projection
-  GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
   glm::mat4 projection =
-      glm::perspective(glm::radians(50.0f), 800.0f / 600.0f, 0.1f, 100.0f);
-  glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+      glm::perspective(glm::radians(50.0f), 800.0f / 600.0f, MESH_NEAR_PLANE,
+                       MESH_FAR_PLANE);
+  glUniformMatrix4fv(this->uniforms.projection, 1, GL_FALSE,
+                     glm::value_ptr(projection));
+  glUniform1i(this->uniforms.instanced, GL_FALSE);
+  glUniform1i(this->uniforms.packedNormals, GL_FALSE);
+  glUniform4fv(this->uniforms.emissive, 1,
+               glm::value_ptr(MESH_MATERIAL_EMISSIVE));
+}
+
+void MeshRenderer::DrawMesh(Mesh *mesh, glm::mat4 model, glm::vec4 emissive) {
+  const MeshDraw draw = this->makeDraw(mesh, mesh->material.get());
+  RenderThread::Submit([this, draw, model, emissive]() {
+    PROFILE_ZONE("MeshRenderer::DrawMesh");
+    glUseProgram(this->shaderProgram);
+    RenderStats::CountProgramSwitch();
+    glUniformMatrix4fv(this->uniforms.model, 1, GL_FALSE,
+                       glm::value_ptr(model));
+    glUniform4fv(this->uniforms.emissive, 1, glm::value_ptr(emissive));
+
+    if (draw.ubo != 0) {
+      this->bindMaterial(draw.ubo);
+    }
+
+    this->setVertexFormat(draw.format);
+    glBindVertexArray(draw.vao);
+    glDrawElements(GL_TRIANGLES, draw.indexCount, draw.indexType, 0);
+    RenderStats::CountDrawCall();
+    glBindVertexArray(0);
+    glUseProgram(0);
+  });
 }
 
-void MeshRenderer::DrawMesh(Mesh *mesh, glm::mat4 model) {
+void MeshRenderer::DrawMeshInstanced(Mesh *mesh, const InstanceData *instances,
+                                     size_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  mesh->ReserveInstances(count);
+  const MeshDraw draw = this->makeDraw(mesh, mesh->material.get());
+
+  if (RenderThread::IsThreaded()) {
+    // the caller may reuse its instance array once this returns
+    RenderThread::Submit(
+        [this, draw, copy = std::vector<InstanceData>(instances,
+                                                      instances + count)]() {
+          this->drawInstanced(draw, copy.data(), copy.size());
+        });
+  } else {
+    this->drawInstanced(draw, instances, count);
+  }
+}
+
+void MeshRenderer::drawInstanced(const MeshDraw &draw,
+                                 const InstanceData *instances, size_t count) {
   glUseProgram(this->shaderProgram);
-  GLint modelLoc = glGetUniformLocation(this->shaderProgram, "model");
-  glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+  RenderStats::CountProgramSwitch();
+  setInstanced(true);
 
-  if (mesh->material) {
-    setMaterialUniforms(this->shaderProgram, mesh->material.get());
+  if (draw.ubo != 0) {
+    this->bindMaterial(draw.ubo);
   }
 
-  glBindVertexArray(mesh->vao);
+  Mesh::UploadInstances(draw.instanceVbo, draw.instanceCapacity, instances,
+                        count);
 
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
-  glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(Vertex3D),
-               mesh->vertices.data(), GL_STATIC_DRAW);
+  setVertexFormat(draw.format);
+  glBindVertexArray(draw.vao);
+  glDrawElementsInstanced(GL_TRIANGLES, draw.indexCount, draw.indexType, 0,
+                          count);
+  RenderStats::CountDrawCall();
+  glBindVertexArray(0);
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(GLuint),
-               mesh->indices.data(), GL_STATIC_DRAW);
+  setInstanced(false);
+  glUseProgram(0);
+}
 
-  // position attribute
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
-                        (void *)offsetof(Vertex3D, position));
-  glEnableVertexAttribArray(0);
+void MeshRenderer::DrawMeshInstanced(
+    Mesh *mesh, const std::vector<InstanceData> &instances) {
+  this->DrawMeshInstanced(mesh, instances.data(), instances.size());
+}
+
+void MeshRenderer::Submit(Mesh *mesh, glm::mat4 model, glm::vec4 emissive) {
+  this->Submit(mesh, mesh->material.get(), model, emissive);
+}
 
-  // texture coord attribute
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
-                        (void *)offsetof(Vertex3D, texCoords));
-  glEnableVertexAttribArray(1);
+void MeshRenderer::Submit(Mesh *mesh, Material *material, glm::mat4 model,
+                          glm::vec4 emissive) {
+  const uint32_t index = this->queue.size();
+  this->queue.push_back({mesh, material, model, emissive});
+  this->sortKeys.push_back({makeSortKey(mesh, material, model), index});
+}
+
+void MeshRenderer::Flush() {
+  if (this->queue.empty()) {
+    return;
+  }
 
-  // normal attribute
-  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
-                        (void *)offsetof(Vertex3D, normal));
-  glEnableVertexAttribArray(2);
+  std::sort(this->sortKeys.begin(), this->sortKeys.end(),
+            [](const SortKey &a, const SortKey &b) { return a.key < b.key; });
 
-  // color attribute
-  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
-                        (void *)offsetof(Vertex3D, color));
-  glEnableVertexAttribArray(3);
+  this->runs.clear();
+  this->runInstances.clear();
+  for (size_t i = 0; i < this->sortKeys.size();) {
+    const DrawCommand &command = this->queue[this->sortKeys[i].index];
 
-  glDrawElements(GL_TRIANGLES, mesh->indices.size(), GL_UNSIGNED_INT, 0);
+    // find the run of commands sharing this mesh and material, they are
+    // adjacent since depth is the lowest part of the key
+    size_t runEnd = i + 1;
+    while (runEnd < this->sortKeys.size()) {
+      const DrawCommand &next = this->queue[this->sortKeys[runEnd].index];
+      if (next.mesh != command.mesh || next.material != command.material) {
+        break;
+      }
+      runEnd++;
+    }
+
+    DrawRun run;
+    run.model = command.model;
+    run.emissive = command.emissive;
+    run.firstInstance = this->runInstances.size();
+    run.instanceCount = runEnd - i;
+    if (run.instanceCount > 1) {
+      command.mesh->ReserveInstances(run.instanceCount);
+      for (size_t j = i; j < runEnd; j++) {
+        const DrawCommand &instance = this->queue[this->sortKeys[j].index];
+        this->runInstances.emplace_back(instance.model, instance.emissive);
+      }
+    }
+    run.draw = this->makeDraw(command.mesh, command.material);
+    this->runs.push_back(run);
+
+    i = runEnd;
+  }
+
+  if (RenderThread::IsThreaded()) {
+    // the render thread takes the built runs and hands them back once drawn,
+    // the next Flush builds into runs it handed back before
+    FlushRuns flushed{std::move(this->runs), std::move(this->runInstances)};
+    RenderThread::Submit([this, flushed = std::move(flushed)]() mutable {
+      this->drawRuns(flushed.runs, flushed.instances);
+      flushed.runs.clear();
+      flushed.instances.clear();
+      std::lock_guard<std::mutex> lock(this->spareMutex);
+      this->spareRuns.push_back(std::move(flushed));
+    });
+
+    std::lock_guard<std::mutex> lock(this->spareMutex);
+    if (!this->spareRuns.empty()) {
+      this->runs = std::move(this->spareRuns.back().runs);
+      this->runInstances = std::move(this->spareRuns.back().instances);
+      this->spareRuns.pop_back();
+    }
+  } else {
+    this->drawRuns(this->runs, this->runInstances);
+  }
+
+  // keep the capacity around for the next frame
+  this->queue.clear();
+  this->sortKeys.clear();
+}
+
+void MeshRenderer::drawRuns(const std::vector<DrawRun> &runs,
+                            const std::vector<InstanceData> &instances) {
+  PROFILE_ZONE("MeshRenderer::Flush");
+
+  glUseProgram(this->shaderProgram);
+  RenderStats::CountProgramSwitch();
+
+  GLuint boundUbo = 0;
+  GLuint boundVao = 0;
+
+  for (const DrawRun &run : runs) {
+    const MeshDraw &draw = run.draw;
+    if (draw.ubo != 0 && draw.ubo != boundUbo) {
+      this->bindMaterial(draw.ubo);
+      boundUbo = draw.ubo;
+    }
+
+    setVertexFormat(draw.format);
+
+    if (run.instanceCount > 1) {
+      // uploading the instances may change the VAO binding, bind it again
+      Mesh::UploadInstances(draw.instanceVbo, draw.instanceCapacity,
+                            &instances[run.firstInstance], run.instanceCount);
+      glBindVertexArray(draw.vao);
+      boundVao = draw.vao;
+
+      setInstanced(true);
+      glDrawElementsInstanced(GL_TRIANGLES, draw.indexCount, draw.indexType,
+                              0, run.instanceCount);
+      RenderStats::CountDrawCall();
+    } else {
+      if (draw.vao != boundVao) {
+        glBindVertexArray(draw.vao);
+        boundVao = draw.vao;
+      }
+
+      setInstanced(false);
+      glUniformMatrix4fv(this->uniforms.model, 1, GL_FALSE,
+                         glm::value_ptr(run.model));
+      glUniform4fv(this->uniforms.emissive, 1, glm::value_ptr(run.emissive));
+      glDrawElements(GL_TRIANGLES, draw.indexCount, draw.indexType, 0);
+      RenderStats::CountDrawCall();
+    }
+  }
+
+  setInstanced(false);
   glBindVertexArray(0);
   glUseProgram(0);
 }
 
+uint64_t MeshRenderer::makeSortKey(const Mesh *mesh, const Material *material,
+                                   const glm::mat4 &model) const {
+  // | program 8 | material 16 | vao 16 | depth 24 |
+  const uint64_t program = this->shaderProgram & 0xFF;
+  const uint64_t materialId = material != nullptr ? material->id : 0xFFFF;
+  const uint64_t vao = mesh->vao & 0xFFFF;
+
+  // view space depth of the origin, front to back so early z can reject
+  const float viewDepth = -(this->view * model[3]).z;
+  const float normalizedDepth =
+      glm::clamp((viewDepth - MESH_NEAR_PLANE) /
+                     (MESH_FAR_PLANE - MESH_NEAR_PLANE),
+                 0.0f, 1.0f);
+  const uint64_t depth = (uint64_t)(normalizedDepth * 0xFFFFFF);
+
+  return program << 56 | materialId << 40 | vao << 24 | depth;
+}
+
 void MeshRenderer::SetViewMatrix(glm::mat4 viewMatrix) {
-  glUseProgram(this->shaderProgram);
-  GLint viewLoc = glGetUniformLocation(this->shaderProgram, "view");
-  glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-  glUseProgram(0);
+  // kept on the recording side for sort keys
+  this->view = viewMatrix;
+  RenderThread::Submit([this, viewMatrix]() {
+    glUseProgram(this->shaderProgram);
+    RenderStats::CountProgramSwitch();
+    glUniformMatrix4fv(this->uniforms.view, 1, GL_FALSE,
+                       glm::value_ptr(viewMatrix));
+    glUseProgram(0);
+  });
+}
+
+void MeshRenderer::setInstanced(bool instanced) {
+  if (this->instanced != instanced) {
+    glUniform1i(this->uniforms.instanced, instanced);
+    this->instanced = instanced;
+  }
+}
+
+void MeshRenderer::setVertexFormat(VertexFormat format) {
+  if (this->vertexFormat != format) {
+    glUniform1i(this->uniforms.packedNormals, format == VertexFormat::Packed);
+    this->vertexFormat = format;
+  }
+}
+
+void MeshRenderer::uploadMaterial(Material *material) {
+  // only upload the block when a factor has changed
+  if (!material->dirty) {
+    return;
+  }
+
+  if (material->ubo == 0) {
+    // only the name is made right away, the block is bound and filled by the
+    // command recorded below
+    RenderThread::Call([material]() { glGenBuffers(1, &material->ubo); });
+  }
+
+  // the factors are snapshotted now, the game may change them while the
+  // frame is still being drawn
+  const GLuint ubo = material->ubo;
+  const MaterialBlock block = material->GetBlock();
+  RenderThread::Submit([ubo, block]() {
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialBlock), &block,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    RenderStats::CountBufferBytes(sizeof(MaterialBlock));
+  });
+  material->dirty = false;
+}
+
+MeshRenderer::MeshDraw MeshRenderer::makeDraw(Mesh *mesh,
+                                              Material *material) {
+  if (material != nullptr) {
+    this->uploadMaterial(material);
+  }
+
+  MeshDraw draw;
+  draw.vao = mesh->vao;
+  draw.indexCount = mesh->indexCount;
+  draw.indexType = mesh->indexType;
+  draw.format = mesh->format;
+  draw.ubo = material != nullptr ? material->ubo : 0;
+  draw.instanceVbo = mesh->instanceVbo;
+  draw.instanceCapacity = mesh->instanceCapacity;
+  return draw;
 }
 
-void MeshRenderer::setMaterialUniforms(GLuint shaderProgram,
-                                       const Material *material) {
-  glUniform3fv(glGetUniformLocation(shaderProgram, "material.baseColorFactor"),
-               1, glm::value_ptr(material->baseColorFactor));
-  glUniform1f(glGetUniformLocation(shaderProgram, "material.metallicFactor"),
-              material->metallicFactor);
-  glUniform1f(glGetUniformLocation(shaderProgram, "material.roughnessFactor"),
-              material->roughnessFactor);
-  glUniform3fv(glGetUniformLocation(shaderProgram, "material.emissiveFactor"),
-               1, glm::value_ptr(material->emissiveFactor));
-  glUniform1f(glGetUniformLocation(shaderProgram, "material.emissiveStrength"),
-              material->emissiveStrength);
+void MeshRenderer::bindMaterial(GLuint ubo) {
+  glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, ubo);
 }
@@ -1,18 +1,229 @@
 #include "mesh.hpp"
+#include "render-stats.hpp"
+#include "render-thread.hpp"
+#include "vertex-packing.hpp"
 
 #include <SDL.h>
+#include <atomic>
 
-Mesh::Mesh(std::vector<Vertex3D> vertices, std::vector<GLuint> indices) {
-  this->vertices = vertices;
-  this->indices = indices;
+PackedVertex3D::PackedVertex3D(const Vertex3D &vertex) {
+  this->position = vertex.position;
+  const glm::vec2 octNormal = OctEncode(vertex.normal);
+  this->normal =
+      glm::i16vec2(PackSnorm16(octNormal.x), PackSnorm16(octNormal.y));
+  this->texCoords =
+      glm::u16vec2(PackHalf(vertex.texCoords.x), PackHalf(vertex.texCoords.y));
+  this->color = glm::u8vec4(PackUnorm8(vertex.color.x),
+                            PackUnorm8(vertex.color.y),
+                            PackUnorm8(vertex.color.z),
+                            PackUnorm8(vertex.color.w));
+}
+
+Material::Material() {
+  static std::atomic<uint16_t> nextId = 0;
+  this->id = nextId++;
+}
+
+Material::~Material() {
+  // queued after any recorded draw that binds the buffer
+  if (this->ubo != 0) {
+    RenderThread::Submit([ubo = this->ubo]() { glDeleteBuffers(1, &ubo); });
+  }
+}
+
+MaterialBlock Material::GetBlock() const {
+  MaterialBlock block = {};
+  block.baseColorFactor = this->baseColorFactor;
+  block.metallicFactor = this->metallicFactor;
+  block.emissiveFactor = this->emissiveFactor;
+  block.emissiveStrength = this->emissiveStrength;
+  block.roughnessFactor = this->roughnessFactor;
+  return block;
+}
+
+size_t GetVertexSize(VertexFormat format) {
+  return format == VertexFormat::Packed ? sizeof(PackedVertex3D)
+                                        : sizeof(Vertex3D);
+}
 
+Mesh::Mesh(std::vector<Vertex3D> vertices, std::vector<GLuint> indices,
+           VertexFormat format) {
+  this->vertices = std::move(vertices);
+  this->indices = std::move(indices);
+  this->indexCount = this->indices.size();
+  this->format = format;
+
+  // use 16 bit indices whenever every vertex is addressable with them
+  std::vector<GLushort> shortIndices;
+  const void *indexData = this->indices.data();
+  size_t indexBytes = this->indices.size() * sizeof(GLuint);
+  this->indexType = GL_UNSIGNED_INT;
+  if (this->vertices.size() <= 0xFFFF) {
+    shortIndices.assign(this->indices.begin(), this->indices.end());
+    indexData = shortIndices.data();
+    indexBytes = shortIndices.size() * sizeof(GLushort);
+    this->indexType = GL_UNSIGNED_SHORT;
+  }
+
+  if (this->format == VertexFormat::Packed) {
+    std::vector<PackedVertex3D> packed(this->vertices.begin(),
+                                       this->vertices.end());
+    RenderThread::Call([&]() {
+      upload(packed.data(), packed.size() * sizeof(PackedVertex3D), indexData,
+             indexBytes);
+    });
+  } else {
+    RenderThread::Call([&]() {
+      upload(this->vertices.data(), this->vertices.size() * sizeof(Vertex3D),
+             indexData, indexBytes);
+    });
+  }
+}
+
+Mesh::Mesh(const void *vertexData, size_t vertexCount, VertexFormat format,
+           const void *indexData, size_t indexCount, GLenum indexType) {
+  this->indexCount = indexCount;
+  this->indexType = indexType;
+  this->format = format;
+
+  const size_t indexSize =
+      indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+  RenderThread::Call([&]() {
+    upload(vertexData, vertexCount * GetVertexSize(format), indexData,
+           indexCount * indexSize);
+  });
+}
+
+void Mesh::upload(const void *vertexData, size_t vertexBytes,
+                  const void *indexData, size_t indexBytes) {
   glGenBuffers(1, &vbo);
   glGenBuffers(1, &ebo);
   glGenVertexArrays(1, &vao);
+
+  glBindVertexArray(this->vao);
+
+  // upload the vertex and index data once, the element buffer binding is
+  // recorded in the VAO
+  glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+  this->bufferBytes = vertexBytes + indexBytes;
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
+  RenderStats::CountBufferBytes(vertexBytes + indexBytes);
+
+  if (this->format == VertexFormat::Packed) {
+    // position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex3D),
+                          (void *)offsetof(PackedVertex3D, position));
+    // texture coord attribute (half float)
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE,
+                          sizeof(PackedVertex3D),
+                          (void *)offsetof(PackedVertex3D, texCoords));
+    // normal attribute (oct encoded snorm16, decoded in the vertex shader)
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex3D),
+                          (void *)offsetof(PackedVertex3D, normal));
+    // color attribute (rgba8)
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          sizeof(PackedVertex3D),
+                          (void *)offsetof(PackedVertex3D, color));
+  } else {
+    // position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
+                          (void *)offsetof(Vertex3D, position));
+    // texture coord attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
+                          (void *)offsetof(Vertex3D, texCoords));
+    // normal attribute
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
+                          (void *)offsetof(Vertex3D, normal));
+    // color attribute
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex3D),
+                          (void *)offsetof(Vertex3D, color));
+  }
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+  glEnableVertexAttribArray(3);
+
+  // unbind the VAO first so the element buffer binding is kept
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 Mesh::~Mesh() {
-  glDeleteBuffers(1, &vbo);
-  glDeleteBuffers(1, &ebo);
-  glDeleteVertexArrays(1, &vao);
+  // queued after any recorded draw of the mesh, draws capture the names
+  RenderThread::Submit([vbo = this->vbo, ebo = this->ebo, vao = this->vao,
+                        instanceVbo = this->instanceVbo]() {
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteVertexArrays(1, &vao);
+    if (instanceVbo != 0) {
+      glDeleteBuffers(1, &instanceVbo);
+    }
+  });
+}
+
+void Mesh::ReleaseCPUData() {
+  // swap with empty vectors so the capacity is actually freed
+  std::vector<Vertex3D>().swap(this->vertices);
+  std::vector<GLuint>().swap(this->indices);
+}
+
+void Mesh::ReserveInstances(size_t count) {
+  if (this->instanceVbo == 0) {
+    // the name is made right away, it touches no binding a frame in flight
+    // relies on
+    RenderThread::Call([this]() { glGenBuffers(1, &this->instanceVbo); });
+
+    // recorded so the VAO changes in order with the frame's draws
+    RenderThread::Submit([vao = this->vao, instanceVbo = this->instanceVbo]() {
+      glBindVertexArray(vao);
+      glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+
+      // a mat4 attribute takes up 4 consecutive locations (4 - 7)
+      for (GLuint i = 0; i < 4; i++) {
+        glVertexAttribPointer(
+            4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void *)(offsetof(InstanceData, model) + sizeof(glm::vec4) * i));
+        glEnableVertexAttribArray(4 + i);
+        glVertexAttribDivisor(4 + i, 1);
+      }
+
+      // emissive override attribute
+      glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                            (void *)offsetof(InstanceData, emissive));
+      glEnableVertexAttribArray(8);
+      glVertexAttribDivisor(8, 1);
+
+      glBindVertexArray(0);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    });
+  }
+
+  if (count > this->instanceCapacity) {
+    // reserve some extra so growing crowds do not reallocate every frame
+    this->instanceCapacity = count + count / 2;
+  }
+}
+
+void Mesh::UploadInstances(GLuint instanceVbo, size_t capacity,
+                           const InstanceData *instances, size_t count) {
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+  // orphan the old storage so we do not wait on draws that still use it
+  glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr,
+               GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+  RenderStats::CountBufferBytes(count * sizeof(InstanceData));
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+size_t Mesh::GetCPUBytes() const {
+  return sizeof(Mesh) + this->vertices.capacity() * sizeof(Vertex3D) +
+         this->indices.capacity() * sizeof(GLuint);
+}
+
+size_t Mesh::GetGPUBytes() const {
+  return this->bufferBytes + this->instanceCapacity * sizeof(InstanceData);
 }
@@ -1,11 +1,35 @@
 #include "model.hpp"
 
+#include "baked-model.hpp"
 #include "tiny_gltf.h"
 #include <SDL.h>
+#include <cstring>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 Model::Model(std::string path) {
+  ModelSource source;
+  if (Load(path, &source)) {
+    *this = Model(std::move(source));
+  }
+}
+
+Model::Model(std::span<const uint8_t> data, const std::string &baseDir) {
+  ModelSource source;
+  if (Load(data, baseDir, &source)) {
+    *this = Model(std::move(source));
+  }
+}
+
+Model::Model(ModelSource source) {
+  if (source.baked.IsValid()) {
+    uploadBaked(source.baked.data);
+  } else {
+    uploadData(source.data);
+  }
+}
+
+bool Model::Load(const std::string &path, ModelSource *out) {
   // get file extension
   std::string ext = path.substr(path.find_last_of('.') + 1);
   for (auto &c : ext) {
@@ -14,24 +38,73 @@ Model::Model(std::string path) {
 
   SDL_Log("File extension: %s", ext.c_str());
 
-  if (ext == "gltf" || ext == "glb") {
-    loadGLTF(path);
-  } else {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                 "Model: Unsupported file format: %s", ext.c_str());
+  if (ext == BAKED_MODEL_EXTENSION) {
+    if (!AssetArchive::Open(path, &out->baked) ||
+        !validateBaked(out->baked)) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                   "Model: Failed to load baked model: %s", path.c_str());
+      out->baked = {};
+      return false;
+    }
+    return true;
+  } else if (ext == "gltf" || ext == "glb") {
+    // prefer the baked sibling produced by the model baker, the source is only
+    // parsed when there is no valid bake next to it and does not have to ship
+    // with one
+    if (AssetArchive::Open(GetBakedModelPath(path), &out->baked)) {
+      if (validateBaked(out->baked)) {
+        SDL_Log("Model: Loading baked model for %s", path.c_str());
+        return true;
+      }
+      SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                  "Model: Ignoring corrupt baked model for %s", path.c_str());
+      out->baked = {};
+    }
+    return ParseGLTF(path, &out->data);
+  }
+
+  SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+               "Model: Unsupported file format: %s", ext.c_str());
+  return false;
+}
+
+bool Model::Load(std::span<const uint8_t> data, const std::string &baseDir,
+                 ModelSource *out) {
+  // a baked model is used in place, glTF is parsed
+  if (ValidateBakedModel(data.data(), data.size()) != nullptr) {
+    out->baked.data = data;
+    return true;
   }
+  return ParseGLTF(data, baseDir, &out->data);
 }
 
-void Model::loadGLTF(std::string path) {
-  const bool isBinary = (path.substr(path.find_last_of('.') + 1) == "glb");
+bool Model::ParseGLTF(const std::string &path, ModelData *out) {
+  AssetBlob blob;
+  if (!AssetArchive::Open(path, &blob)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Model: Could not open %s",
+                 path.c_str());
+    return false;
+  }
+  return ParseGLTF(blob.data, path.substr(0, path.find_last_of('/') + 1), out);
+}
+
+bool Model::ParseGLTF(std::span<const uint8_t> data,
+                      const std::string &baseDir, ModelData *out) {
+  // glb files start with the "glTF" magic, anything else is glTF json
+  const bool isBinary =
+      data.size() >= 4 && memcmp(data.data(), "glTF", 4) == 0;
 
   tinygltf::Model model;
   tinygltf::TinyGLTF loader;
   std::string err;
   std::string warn;
 
-  bool ret = isBinary ? loader.LoadBinaryFromFile(&model, &err, &warn, path)
-                      : loader.LoadASCIIFromFile(&model, &err, &warn, path);
+  bool ret = isBinary ? loader.LoadBinaryFromMemory(&model, &err, &warn,
+                                                    data.data(), data.size(),
+                                                    baseDir)
+                      : loader.LoadASCIIFromString(
+                            &model, &err, &warn, (const char *)data.data(),
+                            data.size(), baseDir);
 
   if (!warn.empty()) {
     SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "TinyGLTF: %s", warn.c_str());
@@ -43,39 +116,40 @@ void Model::loadGLTF(std::string path) {
 
   if (!ret) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "TinyGLTF: Failed to load glTF");
-    return;
+    return false;
   }
 
-  std::vector<std::shared_ptr<Material>> materials;
+  std::vector<MaterialBlock> &materials = out->materials;
+  materials.reserve(std::max<size_t>(model.materials.size(), 1));
 
   // if there are no materials, create a placeholder material
   if (model.materials.empty()) {
-    std::shared_ptr<Material> m = std::make_shared<Material>();
-    m->baseColorFactor = glm::vec3(1.0f, 0.0f, 1.0f);
-    m->metallicFactor = 1.0f;
-    m->roughnessFactor = 1.0f;
-    m->emissiveFactor = m->baseColorFactor;
-    m->emissiveStrength = 1.0f;
+    MaterialBlock m = {};
+    m.baseColorFactor = glm::vec3(1.0f, 0.0f, 1.0f);
+    m.metallicFactor = 1.0f;
+    m.roughnessFactor = 1.0f;
+    m.emissiveFactor = m.baseColorFactor;
+    m.emissiveStrength = 1.0f;
     materials.push_back(m);
   }
 
   // load the materials
   for (const auto &mat : model.materials) {
-    std::shared_ptr<Material> m = std::make_shared<Material>();
+    MaterialBlock m = {};
     // if no base color factor is present, set it to white
     if (mat.pbrMetallicRoughness.baseColorFactor.empty()) {
-      m->baseColorFactor = glm::vec3(1.0f);
+      m.baseColorFactor = glm::vec3(1.0f);
     } else {
-      m->baseColorFactor =
+      m.baseColorFactor =
           glm::vec3(mat.pbrMetallicRoughness.baseColorFactor[0],
                     mat.pbrMetallicRoughness.baseColorFactor[1],
                     mat.pbrMetallicRoughness.baseColorFactor[2]);
     }
-    m->metallicFactor = mat.pbrMetallicRoughness.metallicFactor;
-    m->roughnessFactor = mat.pbrMetallicRoughness.roughnessFactor;
-    m->emissiveFactor = glm::vec3(mat.emissiveFactor[0], mat.emissiveFactor[1],
-                                  mat.emissiveFactor[2]);
-    m->emissiveStrength =
+    m.metallicFactor = mat.pbrMetallicRoughness.metallicFactor;
+    m.roughnessFactor = mat.pbrMetallicRoughness.roughnessFactor;
+    m.emissiveFactor = glm::vec3(mat.emissiveFactor[0], mat.emissiveFactor[1],
+                                 mat.emissiveFactor[2]);
+    m.emissiveStrength =
         mat.extensions.find("KHR_materials_emissive_strength") !=
                 mat.extensions.end()
             ? mat.extensions.at("KHR_materials_emissive_strength")
@@ -85,11 +159,24 @@ void Model::loadGLTF(std::string path) {
     materials.push_back(m);
   }
 
+  // meshes are stored per primitive, remember where each glTF mesh starts so
+  // node transforms can be applied to all of its primitives
+  std::vector<size_t> firstPrimitive;
+  firstPrimitive.reserve(model.meshes.size() + 1);
+  size_t primitiveCount = 0;
+  for (const auto &m : model.meshes) {
+    firstPrimitive.push_back(primitiveCount);
+    primitiveCount += m.primitives.size();
+  }
+  firstPrimitive.push_back(primitiveCount);
+  out->meshes.reserve(primitiveCount);
+
   // Loop through the model and load the meshes
   for (const auto &m : model.meshes) {
     for (const auto &p : m.primitives) {
-      std::vector<Vertex3D> vertices;
-      std::vector<GLuint> indices;
+      MeshData &mesh = out->meshes.emplace_back();
+      std::vector<Vertex3D> &vertices = mesh.vertices;
+      std::vector<GLuint> &indices = mesh.indices;
 
       // Get the vertex data
 
@@ -154,8 +241,9 @@ void Model::loadGLTF(std::string path) {
       const auto &texCompSize = texAccessor.type;
 
       // Populate the vertices vector (pos, texCoords, normal, color)
+      vertices.resize(posCount);
       for (size_t i = 0; i < posCount; i++) {
-        Vertex3D vertex;
+        Vertex3D &vertex = vertices[i];
         vertex.position =
             glm::vec3(posData[i * 3], posData[i * 3 + 1], posData[i * 3 + 2]);
         vertex.normal = glm::vec3(normalData[i * 3], normalData[i * 3 + 1],
@@ -164,8 +252,6 @@ void Model::loadGLTF(std::string path) {
             colorData[i * 4] / 65535.0, colorData[i * 4 + 1] / 65535.0,
             colorData[i * 4 + 2] / 65535.0, colorData[i * 4 + 3] / 65535.0);
         vertex.texCoords = glm::vec2(texData[i * 2], texData[i * 2 + 1]);
-
-        vertices.push_back(vertex);
       }
 
       // Get the index data
@@ -183,30 +269,25 @@ void Model::loadGLTF(std::string path) {
       // Populate the indices vector
       // gltf indices can be of type UNSIGNED_INT, UNSIGNED_SHORT or
       // UNSIGNED_BYTE, without this branching stack smashing occurs
-      for (size_t i = 0; i < indexCount; i++) {
-        if (indexType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT) {
-          const auto *data = reinterpret_cast<const uint32_t *>(indexData);
-          indices.push_back(data[i]);
-        } else if (indexType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT) {
-          const auto *data = reinterpret_cast<const uint16_t *>(indexData);
-          indices.push_back(data[i]);
-        } else if (indexType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE) {
-          const auto *data = reinterpret_cast<const uint8_t *>(indexData);
-          indices.push_back(data[i]);
-        }
+      if (indexType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT) {
+        const auto *data = reinterpret_cast<const uint32_t *>(indexData);
+        indices.assign(data, data + indexCount);
+      } else if (indexType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT) {
+        const auto *data = reinterpret_cast<const uint16_t *>(indexData);
+        indices.assign(data, data + indexCount);
+      } else if (indexType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE) {
+        const auto *data = reinterpret_cast<const uint8_t *>(indexData);
+        indices.assign(data, data + indexCount);
       }
 
-      std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(vertices, indices);
-
       // get the material id
       const auto materialId = p.material;
       if (materialId >= 0) {
         SDL_Log("Material id: %d", materialId);
-        mesh->material = materials[materialId];
+        mesh.material = materialId;
       } else {
-        mesh->material = materials[0];
+        mesh.material = 0;
       }
-      meshes.push_back(mesh);
     }
   }
 
@@ -241,7 +322,85 @@ void Model::loadGLTF(std::string path) {
           model, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
     }
 
-    // add the model matrix to the mesh
-    meshes[meshId]->model = model;
+    // add the model matrix to every primitive of the mesh
+    for (size_t i = firstPrimitive[meshId]; i < firstPrimitive[meshId + 1];
+         i++) {
+      out->meshes[i].model = model;
+    }
+  }
+
+  return true;
+}
+
+void Model::setMaterials(const MaterialBlock *blocks, size_t count) {
+  this->materials.clear();
+  this->materials.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    std::shared_ptr<Material> m = std::make_shared<Material>();
+    m->baseColorFactor = blocks[i].baseColorFactor;
+    m->metallicFactor = blocks[i].metallicFactor;
+    m->roughnessFactor = blocks[i].roughnessFactor;
+    m->emissiveFactor = blocks[i].emissiveFactor;
+    m->emissiveStrength = blocks[i].emissiveStrength;
+    this->materials.push_back(m);
+  }
+}
+
+void Model::uploadData(ModelData &data) {
+  setMaterials(data.materials.data(), data.materials.size());
+
+  this->meshes.reserve(data.meshes.size());
+  for (auto &m : data.meshes) {
+    std::shared_ptr<Mesh> mesh =
+        std::make_shared<Mesh>(std::move(m.vertices), std::move(m.indices));
+    // the data lives on the GPU now, nothing reads the CPU copies
+    mesh->ReleaseCPUData();
+    mesh->material = this->materials[m.material];
+    mesh->model = m.model;
+    this->meshes.push_back(mesh);
+  }
+}
+
+bool Model::validateBaked(const AssetBlob &blob) {
+  return ValidateBakedModel(blob.data.data(), blob.data.size()) != nullptr;
+}
+
+void Model::uploadBaked(std::span<const uint8_t> data) {
+  const uint8_t *base = data.data();
+  const auto *header = reinterpret_cast<const BakedModelHeader *>(base);
+  const auto *materialBlocks = reinterpret_cast<const MaterialBlock *>(
+      base + sizeof(BakedModelHeader));
+  const auto *bakedMeshes = reinterpret_cast<const BakedMesh *>(
+      materialBlocks + header->materialCount);
+
+  setMaterials(materialBlocks, header->materialCount);
+
+  // the mapped data is already in GPU layout, hand it straight to GL
+  this->meshes.reserve(header->meshCount);
+  for (uint32_t i = 0; i < header->meshCount; i++) {
+    const BakedMesh &baked = bakedMeshes[i];
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(
+        base + baked.vertexOffset, baked.vertexCount,
+        (VertexFormat)baked.vertexFormat, base + baked.indexOffset,
+        baked.indexCount, baked.indexType);
+    mesh->material = this->materials[baked.material];
+    memcpy(&mesh->model, baked.model, sizeof(baked.model));
+    this->meshes.push_back(mesh);
+  }
+}
+
+size_t Model::GetCPUBytes() const {
+  size_t bytes = sizeof(Model) + this->materials.size() * sizeof(Material);
+  for (const auto &mesh : this->meshes) {
+    bytes += mesh->GetCPUBytes();
+  }
+  return bytes;
+}
+
+size_t Model::GetGPUBytes() const {
+  size_t bytes = this->materials.size() * sizeof(MaterialBlock);
+  for (const auto &mesh : this->meshes) {
+    bytes += mesh->GetGPUBytes();
   }
+  return bytes;
 }
@@ -0,0 +1,94 @@
+#include "render-stats.hpp"
+
+#include <SDL.h>
+
+static RenderStats *instance = nullptr;
+
+RenderStats *RenderStats::Get() {
+  if (instance == nullptr) {
+    // never freed, like the GL objects that are counted into it
+    instance = new RenderStats();
+  }
+  return instance;
+}
+
+void RenderStats::Attach(RenderStats *stats) {
+  if (stats != nullptr) {
+    instance = stats;
+  }
+}
+
+void RenderStats::CountDrawCall() {
+  RenderStats *stats = RenderStats::Get();
+  stats->frames[stats->current].drawCalls++;
+}
+
+void RenderStats::CountProgramSwitch() {
+  RenderStats *stats = RenderStats::Get();
+  stats->frames[stats->current].programSwitches++;
+}
+
+void RenderStats::CountTextureBind() {
+  RenderStats *stats = RenderStats::Get();
+  stats->frames[stats->current].textureBinds++;
+}
+
+void RenderStats::CountBufferBytes(size_t bytes) {
+  RenderStats *stats = RenderStats::Get();
+  stats->frames[stats->current].bufferBytes += bytes;
+}
+
+void RenderStats::EndFrame() {
+  RenderStats *stats = RenderStats::Get();
+  std::lock_guard<std::mutex> lock(stats->mutex);
+  const RenderCounters &frame = stats->frames[stats->current];
+  if (stats->csv != nullptr) {
+    fprintf(stats->csv, "%llu,%u,%u,%u,%llu\n",
+            (unsigned long long)stats->frameCount, frame.drawCalls,
+            frame.programSwitches, frame.textureBinds,
+            (unsigned long long)frame.bufferBytes);
+  }
+
+  stats->current ^= 1;
+  stats->frames[stats->current] = RenderCounters();
+  stats->frameCount++;
+}
+
+RenderCounters RenderStats::GetLastFrame() {
+  RenderStats *stats = RenderStats::Get();
+  std::lock_guard<std::mutex> lock(stats->mutex);
+  return stats->frames[stats->current ^ 1];
+}
+
+const RenderCounters &RenderStats::GetCurrentFrame() {
+  RenderStats *stats = RenderStats::Get();
+  return stats->frames[stats->current];
+}
+
+uint64_t RenderStats::GetFrameCount() {
+  RenderStats *stats = RenderStats::Get();
+  std::lock_guard<std::mutex> lock(stats->mutex);
+  return stats->frameCount;
+}
+
+bool RenderStats::OpenCsv(const char *path) {
+  RenderStats::CloseCsv();
+  RenderStats *stats = RenderStats::Get();
+  stats->csv = fopen(path, "w");
+  if (stats->csv == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "RenderStats: could not write %s", path);
+    return false;
+  }
+  fputs("frame,draw_calls,program_switches,texture_binds,buffer_bytes\n",
+        stats->csv);
+  return true;
+}
+
+void RenderStats::CloseCsv() {
+  RenderStats *stats = RenderStats::Get();
+  if (stats->csv != nullptr) {
+    fclose(stats->csv);
+    stats->csv = nullptr;
+  }
+}
@@ -0,0 +1,159 @@
+#include "render-thread.hpp"
+
+#include <SDL.h>
+#include <profiler.hpp>
+
+static RenderThread *instance = nullptr;
+
+RenderThread *RenderThread::Get() {
+  if (instance == nullptr) {
+    // never freed, destructors may submit during static destruction
+    instance = new RenderThread();
+  }
+  return instance;
+}
+
+void RenderThread::Attach(RenderThread *thread) {
+  if (thread != nullptr) {
+    instance = thread;
+  }
+}
+
+void RenderThread::Start(Command acquire, Command release) {
+  RenderThread *self = RenderThread::Get();
+#ifdef EMSCRIPTEN
+  // no threads on the web build, everything keeps running inline
+  (void)acquire;
+  (void)release;
+  (void)self;
+#else
+  if (self->running) {
+    return;
+  }
+  self->release = std::move(release);
+  self->stopping = false;
+  self->running = true;
+  self->thread = std::thread([self, acquire = std::move(acquire)]() {
+    acquire();
+    self->run();
+  });
+  self->threadId = self->thread.get_id();
+  SDL_Log("RenderThread: started");
+#endif
+}
+
+void RenderThread::Stop() {
+  RenderThread *self = RenderThread::Get();
+  if (!self->running) {
+    return;
+  }
+  RenderThread::Drain();
+  {
+    std::lock_guard<std::mutex> lock(self->mutex);
+    self->stopping = true;
+  }
+  self->wake.notify_one();
+  self->thread.join();
+  self->running = false;
+  self->threadId = std::thread::id();
+  SDL_Log("RenderThread: stopped");
+}
+
+bool RenderThread::IsThreaded() { return RenderThread::Get()->running; }
+
+bool RenderThread::IsRenderThread() {
+  return std::this_thread::get_id() == RenderThread::Get()->threadId;
+}
+
+void RenderThread::Submit(Command command) {
+  RenderThread *self = RenderThread::Get();
+  if (!self->running || RenderThread::IsRenderThread()) {
+    command();
+    return;
+  }
+  std::lock_guard<std::mutex> lock(self->mutex);
+  self->recording.push_back(std::move(command));
+}
+
+void RenderThread::Call(const Command &command) {
+  RenderThread *self = RenderThread::Get();
+  if (!self->running || RenderThread::IsRenderThread()) {
+    command();
+    return;
+  }
+
+  bool finished = false;
+  std::unique_lock<std::mutex> lock(self->mutex);
+  self->calls.push_back({&command, &finished});
+  self->wake.notify_one();
+  self->done.wait(lock, [&]() { return finished; });
+}
+
+void RenderThread::EndFrame() {
+  RenderThread *self = RenderThread::Get();
+  if (!self->running || RenderThread::IsRenderThread()) {
+    return;
+  }
+  PROFILE_ZONE("RenderThread::Wait");
+  std::unique_lock<std::mutex> lock(self->mutex);
+  self->done.wait(lock, [self]() { return !self->frameReady; });
+  // the executed list is empty, its capacity is reused for recording
+  std::swap(self->recording, self->executing);
+  self->frameReady = true;
+  self->wake.notify_one();
+}
+
+void RenderThread::Drain() {
+  RenderThread *self = RenderThread::Get();
+  if (!self->running || RenderThread::IsRenderThread()) {
+    return;
+  }
+  RenderThread::EndFrame();
+  std::unique_lock<std::mutex> lock(self->mutex);
+  self->done.wait(lock, [self]() { return !self->frameReady; });
+}
+
+void RenderThread::runCalls(std::unique_lock<std::mutex> &lock) {
+  while (!this->calls.empty()) {
+    std::vector<PendingCall> calls;
+    std::swap(calls, this->calls);
+    lock.unlock();
+    for (const PendingCall &call : calls) {
+      (*call.command)();
+    }
+    lock.lock();
+    for (const PendingCall &call : calls) {
+      *call.finished = true;
+    }
+    this->done.notify_all();
+  }
+}
+
+void RenderThread::run() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true) {
+    this->wake.wait(lock, [this]() {
+      return this->stopping || this->frameReady || !this->calls.empty();
+    });
+    this->runCalls(lock);
+
+    if (this->frameReady) {
+      lock.unlock();
+      for (size_t i = 0; i < this->executing.size(); i++) {
+        this->executing[i]();
+        // keep loads responsive while a long frame draws
+        lock.lock();
+        this->runCalls(lock);
+        lock.unlock();
+      }
+      this->executing.clear();
+      lock.lock();
+      this->frameReady = false;
+      this->done.notify_all();
+    } else if (this->stopping) {
+      break;
+    }
+  }
+  lock.unlock();
+  this->release();
+}
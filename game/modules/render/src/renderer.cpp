@@ -2,10 +2,16 @@
 #include <fstream>
 #include <sstream>
 
+#include "gpu-timer.hpp"
+#include "headless-context.hpp"
+#include "render-stats.hpp"
+#include "render-thread.hpp"
+#include "texture.hpp"
 #include "window.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <profiler.hpp>
 
 void Renderer::openglCallbackFunction(GLenum source, GLenum type, GLuint id,
                                       GLenum severity, GLsizei length,
@@ -48,7 +54,8 @@ Renderer::Renderer(Window *window) {
 #endif
 #endif
 
-  this->glContext = SDL_GL_CreateContext(window->GetSDLWindow());
+  this->window = window->GetSDLWindow();
+  this->glContext = SDL_GL_CreateContext(this->window);
   if (!this->glContext) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                  "Failed to create OpenGL context: %s", SDL_GetError());
@@ -57,6 +64,20 @@ Renderer::Renderer(Window *window) {
 
   // Initialize GLAD
   gladLoadGLES2Loader((GLADloadproc)SDL_GL_GetProcAddress);
+  this->initState();
+}
+
+Renderer::Renderer(int width, int height) {
+  this->headless = std::make_unique<HeadlessContext>(width, height);
+  if (!this->headless->IsValid()) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "Failed to create headless OpenGL context");
+    return;
+  }
+  this->initState();
+}
+
+void Renderer::initState() {
   SDL_Log("OpenGL %d.%d", GLVersion.major, GLVersion.minor);
   SDL_Log("OpenGL %s, GLSL %s", glGetString(GL_VERSION),
           glGetString(GL_SHADING_LANGUAGE_VERSION));
@@ -85,24 +106,90 @@ Renderer::Renderer(Window *window) {
   // Set up OpenGL state
   glClearColor(0.25f, .25f, 0.25f, 1.0f);
 
+  // a context made after another may support different formats
+  Texture::QueryCompressedFormats();
+
+#ifdef PROFILER_ENABLED
+  this->gpuTimer = std::make_unique<GpuTimer>();
+#endif
+
   SDL_Log("OpenGL state initialized");
+  this->valid = true;
 }
 
 Renderer::~Renderer() {
+  // everything below needs the context on this thread again
+  if (RenderThread::IsThreaded()) {
+    RenderThread::Stop();
+    if (this->headless) {
+      this->headless->MakeCurrent();
+    } else {
+      SDL_GL_MakeCurrent(this->window, this->glContext);
+    }
+  }
+  // the queries belong to the context
+  this->gpuTimer.reset();
   // Destroy OpenGL context
-  SDL_GL_DeleteContext(this->glContext);
+  if (this->glContext != nullptr) {
+    SDL_GL_DeleteContext(this->glContext);
+  }
+  this->headless.reset();
   SDL_Log("OpenGL context destroyed");
 }
 
-void Renderer::Clear() {
-  // Clear the color buffer
-  glClear(GL_COLOR_BUFFER_BIT);
+GLProcLoader Renderer::GetProcLoader() const {
+  if (this->headless) {
+    return HeadlessContext::GetProcAddress;
+  }
+  return SDL_GL_GetProcAddress;
+}
 
-  // Clear the depth buffer
-  glClear(GL_DEPTH_BUFFER_BIT);
+void Renderer::StartRenderThread() {
+  if (this->headless) {
+    this->headless->Release();
+    RenderThread::Start([this]() { this->headless->MakeCurrent(); },
+                        [this]() { this->headless->Release(); });
+    return;
+  }
+  SDL_GL_MakeCurrent(this->window, nullptr);
+  RenderThread::Start(
+      [this]() { SDL_GL_MakeCurrent(this->window, this->glContext); },
+      [this]() { SDL_GL_MakeCurrent(this->window, nullptr); });
+}
+
+void Renderer::Clear() {
+  const uint64_t frame = Profiler::GetFrameNumber();
+  RenderThread::Submit([this, frame]() {
+    PROFILE_ZONE("Renderer::Clear");
+    if (this->gpuTimer) {
+      this->gpuTimer->BeginFrame(frame);
+    }
+
+    // Clear the color buffer
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Clear the depth buffer
+    glClear(GL_DEPTH_BUFFER_BIT);
+  });
 }
 
 void Renderer::Present() {
-  // Swap the front and back buffers
-  SDL_GL_SwapWindow(SDL_GL_GetCurrentWindow());
+  RenderThread::Submit([this]() {
+    PROFILE_ZONE("Renderer::Present");
+    if (this->gpuTimer) {
+      this->gpuTimer->EndFrame();
+      this->gpuTimer->Collect();
+    }
+    RenderStats::EndFrame();
+
+    if (this->headless) {
+      // nothing to show, wait for the frame like a blocking swap would so
+      // frame times include the GPU work
+      glFinish();
+      return;
+    }
+    // Swap the front and back buffers
+    SDL_GL_SwapWindow(SDL_GL_GetCurrentWindow());
+  });
+  RenderThread::EndFrame();
 }
@@ -0,0 +1,84 @@
+#include "sdf.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#define SDF_INFINITY 1e20f
+
+// exact 1D squared euclidean distance transform (Felzenszwalb and
+// Huttenlocher), f holds 0 on feature pixels and SDF_INFINITY elsewhere
+static void transform1D(const float *f, float *d, int n, int *v, float *z) {
+  int k = 0;
+  v[0] = 0;
+  z[0] = -SDF_INFINITY;
+  z[1] = SDF_INFINITY;
+  for (int q = 1; q < n; q++) {
+    float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+    while (s <= z[k]) {
+      k--;
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = SDF_INFINITY;
+  }
+
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q) {
+      k++;
+    }
+    d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+
+// squared distance of every pixel to the nearest pixel where grid is 0
+static void transform2D(std::vector<float> &grid, int w, int h) {
+  const int n = std::max(w, h);
+  std::vector<float> f(n), d(n), z(n + 1);
+  std::vector<int> v(n);
+
+  for (int x = 0; x < w; x++) {
+    for (int y = 0; y < h; y++) {
+      f[y] = grid[(size_t)y * w + x];
+    }
+    transform1D(f.data(), d.data(), h, v.data(), z.data());
+    for (int y = 0; y < h; y++) {
+      grid[(size_t)y * w + x] = d[y];
+    }
+  }
+
+  for (int y = 0; y < h; y++) {
+    transform1D(&grid[(size_t)y * w], d.data(), w, v.data(), z.data());
+    std::copy(d.begin(), d.begin() + w, grid.begin() + (size_t)y * w);
+  }
+}
+
+void GenerateSDF(const uint8_t *coverage, int w, int h, int pitch, int spread,
+                 std::vector<uint8_t> *out) {
+  const int outW = w + spread * 2;
+  const int outH = h + spread * 2;
+
+  // distance to the nearest inside pixel and to the nearest outside pixel
+  std::vector<float> toInside((size_t)outW * outH, SDF_INFINITY);
+  std::vector<float> toOutside((size_t)outW * outH, 0.0f);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      if (coverage[(size_t)y * pitch + x] >= 128) {
+        const size_t i = (size_t)(y + spread) * outW + x + spread;
+        toInside[i] = 0.0f;
+        toOutside[i] = SDF_INFINITY;
+      }
+    }
+  }
+  transform2D(toInside, outW, outH);
+  transform2D(toOutside, outW, outH);
+
+  out->resize((size_t)outW * outH);
+  for (size_t i = 0; i < out->size(); i++) {
+    const float distance = std::sqrt(toOutside[i]) - std::sqrt(toInside[i]);
+    (*out)[i] = (uint8_t)std::clamp(
+        (int)std::lround(128.0f + distance * 128.0f / spread), 0, 255);
+  }
+}
@@ -1,31 +1,30 @@
 #include "shader.hpp"
+#include "render-thread.hpp"
+
 #include <SDL.h>
-#include <fstream>
-#include <sstream>
+#include <archive.hpp>
 #include <vector>
 
 Shader::Shader() {}
 
 Shader::~Shader() {
-  if (shader != 0) {
-    glDeleteShader(shader);
+  if (this->shader != 0) {
+    RenderThread::Submit(
+        [shader = this->shader]() { glDeleteShader(shader); });
   }
 }
 
 bool Shader::LoadFromFile(const char *filePath, GLenum shaderType) {
 
   // Load vertex shader
-  std::ifstream shaderFile(filePath);
-
-  if (!shaderFile.good()) {
+  AssetBlob blob;
+  if (!AssetArchive::Open(filePath, &blob)) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open shader file: %s",
                  filePath);
     return false;
   }
 
-  std::stringstream shaderStream;
-  shaderStream << shaderFile.rdbuf();
-  std::string shaderSource = shaderStream.str();
+  std::string shaderSource((const char *)blob.data.data(), blob.data.size());
 
 #ifdef __APPLE__
   // replace #version 300 es with #version 410
@@ -37,12 +36,18 @@ bool Shader::LoadFromFile(const char *filePath, GLenum shaderType) {
 }
 
 bool Shader::LoadFromString(std::string source, GLenum shaderType) {
+  bool compiled = false;
+  RenderThread::Call(
+      [&]() { compiled = this->compile(source.c_str(), shaderType); });
+  return compiled;
+}
+
+bool Shader::compile(const char *source, GLenum shaderType) {
   // Create vertex shader object
   this->type = shaderType;
   this->shader = glCreateShader(shaderType);
 
-  const char *shaderSourcePtr = source.c_str();
-  glShaderSource(this->shader, 1, &shaderSourcePtr, nullptr);
+  glShaderSource(this->shader, 1, &source, nullptr);
   glCompileShader(this->shader);
 
   // Check vertex shader compilation status
@@ -59,6 +64,7 @@ bool Shader::LoadFromString(std::string source, GLenum shaderType) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                  "Failed to compile %i shader: %s", shaderType, log.c_str());
     glDeleteShader(this->shader);
+    this->shader = 0;
     return false;
   }
 
@@ -1,9 +1,25 @@
 #include "sprite-batch.hpp"
+#include "render-stats.hpp"
+#include "render-thread.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <profiler.hpp>
+#include <simd.hpp>
 
 SpriteBatch::SpriteBatch(glm::vec2 windowSize) {
+  RenderThread::Call([&]() { this->createGLObjects(windowSize); });
+}
+
+SpriteBatch::~SpriteBatch() {
+  // flushes still in flight draw with this batch's buffers
+  RenderThread::Drain();
+  RenderThread::Call([this]() { this->deleteGLObjects(); });
+}
+
+void SpriteBatch::createGLObjects(glm::vec2 windowSize) {
   this->vertexShader.LoadFromFile("assets/shaders/sprite.vert",
                                   GL_VERTEX_SHADER);
   this->fragmentShader.LoadFromFile("assets/shaders/sprite.frag",
@@ -33,54 +49,114 @@ SpriteBatch::SpriteBatch(glm::vec2 windowSize) {
     return;
   }
 
-  this->textureUniform =
-      glGetUniformLocation(this->shaderProgram, "albedoTexture");
-  this->texture = NULL;
+  this->textureUniform = glGetUniformLocation(this->shaderProgram, "textures");
+  this->texture = 0;
+
+  // texture slot n is always bound to texture unit n
+  GLint textureUnits[SPRITE_BATCH_MAX_TEXTURES];
+  for (GLint i = 0; i < SPRITE_BATCH_MAX_TEXTURES; i++) {
+    textureUnits[i] = i;
+  }
+  glUseProgram(this->shaderProgram);
+  RenderStats::CountProgramSwitch();
+  glUniform1iv(this->textureUniform, SPRITE_BATCH_MAX_TEXTURES, textureUnits);
+  glUseProgram(0);
+
+  glGenSamplers(1, &this->sampler);
+  // cooked textures carry mips, the rest clamp to level 0 via MAX_LEVEL
+  glSamplerParameteri(this->sampler, GL_TEXTURE_MIN_FILTER,
+                      GL_NEAREST_MIPMAP_NEAREST);
+  glSamplerParameteri(this->sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glSamplerParameteri(this->sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glSamplerParameteri(this->sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glGenSamplers(1, &this->linearSampler);
+  glSamplerParameteri(this->linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glSamplerParameteri(this->linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glSamplerParameteri(this->linearSampler, GL_TEXTURE_WRAP_S,
+                      GL_CLAMP_TO_EDGE);
+  glSamplerParameteri(this->linearSampler, GL_TEXTURE_WRAP_T,
+                      GL_CLAMP_TO_EDGE);
 
   // Create and bind a VAO
   glGenVertexArrays(1, &this->vao);
   glBindVertexArray(this->vao);
 
-  // Create and bind the EBO
+  // Create and bind the EBO, the indices for every quad slot in the vertex
+  // buffer are generated once
+  std::vector<GLushort> indices;
+  indices.reserve(SPRITE_BATCH_BUFFER_SPRITES * 6);
+  for (GLushort i = 0; i < SPRITE_BATCH_BUFFER_SPRITES; i++) {
+    const GLushort vertexIndexOffset = i * 4;
+    indices.push_back(vertexIndexOffset + 0);
+    indices.push_back(vertexIndexOffset + 1);
+    indices.push_back(vertexIndexOffset + 2);
+    indices.push_back(vertexIndexOffset + 2);
+    indices.push_back(vertexIndexOffset + 1);
+    indices.push_back(vertexIndexOffset + 3);
+  }
+
   glGenBuffers(1, &this->ebo);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort),
+               indices.data(), GL_STATIC_DRAW);
+  RenderStats::CountBufferBytes(indices.size() * sizeof(GLushort));
 
-  // Create and bind the VBO
+  // Create and bind the VBO, allocated once and streamed into on flush
   glGenBuffers(1, &this->vbo);
   glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+  glBufferData(GL_ARRAY_BUFFER,
+               SPRITE_BATCH_BUFFER_SPRITES * 4 * sizeof(Vertex), nullptr,
+               GL_STREAM_DRAW);
 
   // Configure vertex attribute pointers in the VAO
 
   glEnableVertexAttribArray(0); // position
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *)0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (GLvoid *)offsetof(Vertex, position));
 
-  glEnableVertexAttribArray(1); // uv
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (GLvoid *)sizeof(glm::vec2));
+  glEnableVertexAttribArray(1); // uv (unorm16)
+  glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex),
+                        (GLvoid *)offsetof(Vertex, texCoords));
 
-  glEnableVertexAttribArray(2); // color
-  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (GLvoid *)sizeof(glm::vec4));
+  glEnableVertexAttribArray(2); // color (rgba8)
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex),
+                        (GLvoid *)offsetof(Vertex, color));
 
-  glEnableVertexAttribArray(3); // rotation
-  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (GLvoid *)(2 * sizeof(glm::vec2) + sizeof(glm::vec4)));
+  glEnableVertexAttribArray(3); // texture index
+  glVertexAttribIPointer(3, 1, GL_UNSIGNED_BYTE, sizeof(Vertex),
+                         (GLvoid *)offsetof(Vertex, textureIndex));
 
   // Unbind the VAO and VBO
   glBindVertexArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  this->vertices.reserve(SPRITE_BATCH_MAX_SPRITES * 4);
 
   this->projectionUniform =
       glGetUniformLocation(this->shaderProgram, "projection");
   this->viewUniform = glGetUniformLocation(this->shaderProgram, "view");
+  this->textOutlineUniform =
+      glGetUniformLocation(this->shaderProgram, "text_outline");
+  this->textOutlineColorUniform =
+      glGetUniformLocation(this->shaderProgram, "text_outline_color");
 
   this->SetProjection(windowSize);
 }
 
-SpriteBatch::~SpriteBatch() {
+void SpriteBatch::deleteGLObjects() {
+  for (GLsync fence : this->regionFences) {
+    if (fence != nullptr) {
+      glDeleteSync(fence);
+    }
+  }
+
   glDeleteBuffers(1, &this->vbo);
   glDeleteBuffers(1, &this->ebo);
   glDeleteVertexArrays(1, &this->vao);
+  glDeleteSamplers(1, &this->sampler);
+  glDeleteSamplers(1, &this->linearSampler);
 
   glDeleteProgram(this->shaderProgram);
 }
@@ -110,13 +186,10 @@ void SpriteBatch::Draw(Texture *texture, glm::vec2 position, glm::vec2 scale,
                        float rotation, glm::vec4 color, glm::vec4 srcRect,
                        glm::vec2 flipPadding) {
 
-  if (this->texture != texture->GetGLTexture()) {
-    this->Flush();
-    this->texture = texture->GetGLTexture();
-  }
-
-  this->textureRect =
-      texture != nullptr ? texture->GetTextureRect() : glm::ivec4(0, 0, 1, 1);
+  // textures no longer split the batch, each vertex carries a texture slot
+  this->texture = texture->GetGLTexture();
+  this->textureRect = texture->GetTextureRect();
+  this->textureFlags = 0;
   if (srcRect == glm::vec4(0, 0, 0, 0)) {
     srcRect = this->textureRect;
   }
@@ -131,37 +204,34 @@ void SpriteBatch::Draw(Texture *texture, glm::vec2 position, glm::vec2 scale,
 void SpriteBatch::Draw(GLuint texture, glm::vec2 position, glm::vec2 scale,
                        float rotation, glm::vec4 color, glm::vec4 srcRect,
                        glm::vec2 flipPadding) {
-  glm::vec2 center(position.x + (srcRect.z * scale.x) * 0.5f,
-                   position.y + (srcRect.w * scale.y) * 0.5f);
-
-  glm::vec2 scaledTopLeft(-srcRect.z * scale.x * 0.5f,
-                          -srcRect.w * scale.y * 0.5f);
-  glm::vec2 scaledTopRight(srcRect.z * scale.x * 0.5f,
-                           -srcRect.w * scale.y * 0.5f);
-  glm::vec2 scaledBottomLeft(-srcRect.z * scale.x * 0.5f,
-                             srcRect.w * scale.y * 0.5f);
-  glm::vec2 scaledBottomRight(srcRect.z * scale.x * 0.5f,
-                              srcRect.w * scale.y * 0.5f);
-
-  // Rotate the vertices
-  const glm::mat2 rotationMatrix(glm::cos(rotation), -glm::sin(rotation),
-                                 glm::sin(rotation), glm::cos(rotation));
-  scaledTopLeft = rotationMatrix * scaledTopLeft + center;
-  scaledTopRight = rotationMatrix * scaledTopRight + center;
-  scaledBottomLeft = rotationMatrix * scaledBottomLeft + center;
-  scaledBottomRight = rotationMatrix * scaledBottomRight + center;
-
-  const float textureWidth = this->textureRect.z;
-  const float textureHeight = this->textureRect.w;
-
-  const glm::vec2 uvTopLeft(srcRect.x / textureWidth,
-                            srcRect.y / textureHeight);
-  const glm::vec2 uvTopRight((srcRect.x + srcRect.z) / textureWidth,
-                             srcRect.y / textureHeight);
-  const glm::vec2 uvBottomLeft(srcRect.x / textureWidth,
-                               (srcRect.y + srcRect.w) / textureHeight);
-  const glm::vec2 uvBottomRight((srcRect.x + srcRect.z) / textureWidth,
-                                (srcRect.y + srcRect.w) / textureHeight);
+  const glm::vec2 size(srcRect.z * scale.x, srcRect.w * scale.y);
+
+  glm::vec2 scaledTopLeft, scaledTopRight, scaledBottomLeft,
+      scaledBottomRight;
+  if (rotation == 0.0f) {
+    // axis aligned, the corners are the position offset by the size
+    scaledTopLeft = position;
+    scaledTopRight = glm::vec2(position.x + size.x, position.y);
+    scaledBottomLeft = glm::vec2(position.x, position.y + size.y);
+    scaledBottomRight = position + size;
+  } else {
+    const glm::vec2 center = position + size * 0.5f;
+    const glm::vec2 half = size * 0.5f;
+
+    // Rotate the vertices
+    const glm::mat2 rotationMatrix(glm::cos(rotation), -glm::sin(rotation),
+                                   glm::sin(rotation), glm::cos(rotation));
+    scaledTopLeft = rotationMatrix * glm::vec2(-half.x, -half.y) + center;
+    scaledTopRight = rotationMatrix * glm::vec2(half.x, -half.y) + center;
+    scaledBottomLeft = rotationMatrix * glm::vec2(-half.x, half.y) + center;
+    scaledBottomRight = rotationMatrix * glm::vec2(half.x, half.y) + center;
+  }
+
+  const glm::vec2 invTextureSize(1.0f / this->textureRect.z,
+                                 1.0f / this->textureRect.w);
+  const glm::vec2 uvMin = glm::vec2(srcRect.x, srcRect.y) * invTextureSize;
+  const glm::vec2 uvMax =
+      glm::vec2(srcRect.x + srcRect.z, srcRect.y + srcRect.w) * invTextureSize;
 
   // dumb but works
   if (scale.y < 0) {
@@ -177,33 +247,111 @@ void SpriteBatch::Draw(GLuint texture, glm::vec2 position, glm::vec2 scale,
     scaledTopLeft.x += flipPadding.x;
   }
 
-  // Calculate the vertex index offset for the current sprite
-  const int vertexIndexOffset = this->vertices.size();
-
-  // Add vertices to the list
-  this->vertices.push_back(Vertex(scaledTopLeft, uvTopLeft, color));
-  this->vertices.push_back(Vertex(scaledTopRight, uvTopRight, color));
-  this->vertices.push_back(Vertex(scaledBottomLeft, uvBottomLeft, color));
-  this->vertices.push_back(Vertex(scaledBottomRight, uvBottomRight, color));
-
-  // Add indices for the two triangles forming the quad for the current sprite
-  // Add indices offset by vertexIndexOffset
-  this->indices.push_back(vertexIndexOffset + 0);
-  this->indices.push_back(vertexIndexOffset + 1);
-  this->indices.push_back(vertexIndexOffset + 2);
-  this->indices.push_back(vertexIndexOffset + 2);
-  this->indices.push_back(vertexIndexOffset + 1);
-  this->indices.push_back(vertexIndexOffset + 3);
+  if (this->vertices.size() >= SPRITE_BATCH_MAX_SPRITES * 4) {
+    this->Flush();
+  }
+
+  GLuint slot = this->acquireTextureSlot(texture);
+  if (this->textureFlags & SPRITE_BATCH_SDF_TEXTURE) {
+    this->linearSlots |= 1u << slot;
+  }
+  slot |= this->textureFlags;
+
+  // Add vertices to the list, the indices are static
+  this->vertices.push_back(Vertex(scaledTopLeft, uvMin, color, slot));
+  this->vertices.push_back(
+      Vertex(scaledTopRight, glm::vec2(uvMax.x, uvMin.y), color, slot));
+  this->vertices.push_back(
+      Vertex(scaledBottomLeft, glm::vec2(uvMin.x, uvMax.y), color, slot));
+  this->vertices.push_back(Vertex(scaledBottomRight, uvMax, color, slot));
 }
 
-void SpriteBatch::DrawRect(glm::vec4 destRect, glm::vec4 color) {
+void GenerateSpriteQuads(const SpriteInstance *sprites, size_t count,
+                         glm::vec2 invTextureSize, uint8_t textureIndex,
+                         Vertex *out) {
+  // (0, 0, 1, 1) turns x, y, w, h into x0, y0, x1, y1 with one multiply add
+  const simd::float4 extent = simd::Set(0.0f, 0.0f, 1.0f, 1.0f);
+  // unorm16 scale, the 0.5 rounds during the truncating conversion
+  const simd::float4 uvScale =
+      simd::Set(invTextureSize.x * 65535.0f, invTextureSize.y * 65535.0f,
+                invTextureSize.x * 65535.0f, invTextureSize.y * 65535.0f);
+  const simd::float4 half = simd::Splat(0.5f);
+  const simd::float4 zero = simd::Splat(0.0f);
+  const simd::float4 one = simd::Splat(65535.0f);
+
+  alignas(16) float corners[4];
+  alignas(16) int32_t uvs[4];
+  for (size_t i = 0; i < count; i++) {
+    const SpriteInstance &sprite = sprites[i];
+
+    const simd::float4 dest = simd::Load(&sprite.destRect.x);
+    simd::Store(corners, simd::Add(simd::XYXY(dest),
+                                   simd::Mul(simd::ZWZW(dest), extent)));
+
+    const simd::float4 src = simd::Load(&sprite.srcRect.x);
+    const simd::float4 texels =
+        simd::Add(simd::XYXY(src), simd::Mul(simd::ZWZW(src), extent));
+    simd::StoreInt(uvs, simd::Min(simd::Max(simd::Add(simd::Mul(texels,
+                                                                uvScale),
+                                                      half),
+                                            zero),
+                                  one));
+
+    // same corner order as Draw: top left, top right, bottom left, bottom
+    // right
+    Vertex *quad = out + i * 4;
+    for (int corner = 0; corner < 4; corner++) {
+      const int x = (corner & 1) * 2;
+      const int y = (corner >> 1) * 2 + 1;
+      quad[corner].position = glm::vec2(corners[x], corners[y]);
+      quad[corner].texCoords = glm::u16vec2(uvs[x], uvs[y]);
+      quad[corner].color = sprite.color;
+      quad[corner].textureIndex = textureIndex;
+    }
+  }
+}
 
-  if (this->texture != NULL) {
-    this->Flush();
-    this->texture = NULL;
+void SpriteBatch::DrawMany(Texture *texture,
+                           std::span<const SpriteInstance> sprites) {
+  this->texture = texture->GetGLTexture();
+  this->textureRect = texture->GetTextureRect();
+  this->textureFlags = 0;
+  this->DrawMany(this->texture, sprites);
+}
+
+void SpriteBatch::DrawMany(GLuint texture,
+                           std::span<const SpriteInstance> sprites) {
+  const glm::vec2 invTextureSize(1.0f / this->textureRect.z,
+                                 1.0f / this->textureRect.w);
+
+  size_t offset = 0;
+  while (offset < sprites.size()) {
+    if (this->vertices.size() >= SPRITE_BATCH_MAX_SPRITES * 4) {
+      this->Flush();
+    }
+
+    // may flush, so the room left is only known afterwards
+    GLuint slot = this->acquireTextureSlot(texture);
+    if (this->textureFlags & SPRITE_BATCH_SDF_TEXTURE) {
+      this->linearSlots |= 1u << slot;
+    }
+    slot |= this->textureFlags;
+
+    const size_t count =
+        std::min(SPRITE_BATCH_MAX_SPRITES - this->vertices.size() / 4,
+                 sprites.size() - offset);
+    const size_t first = this->vertices.size();
+    this->vertices.resize(first + count * 4);
+    GenerateSpriteQuads(&sprites[offset], count, invTextureSize, slot,
+                        &this->vertices[first]);
+    offset += count;
   }
+}
 
-  const int vertexIndexOffset = this->vertices.size();
+void SpriteBatch::DrawRect(glm::vec4 destRect, glm::vec4 color) {
+  if (this->vertices.size() >= SPRITE_BATCH_MAX_SPRITES * 4) {
+    this->Flush();
+  }
 
   const auto topLeft = glm::vec2(destRect.x, destRect.y);
   const auto topRight = glm::vec2(destRect.x + destRect.z, destRect.y);
@@ -216,19 +364,41 @@ void SpriteBatch::DrawRect(glm::vec4 destRect, glm::vec4 color) {
   const auto uvBottomLeft = glm::vec2(0, 1);
   const auto uvBottomRight = glm::vec2(1, 1);
 
-  this->vertices.push_back(Vertex(topLeft, uvTopLeft, color));
-  this->vertices.push_back(Vertex(topRight, uvTopRight, color));
-  this->vertices.push_back(Vertex(bottomLeft, uvBottomLeft, color));
-  this->vertices.push_back(Vertex(bottomRight, uvBottomRight, color));
-
-  // Add indices for the two triangles forming the quad for the current sprite
-  // Add indices offset by vertexIndexOffset
-  this->indices.push_back(vertexIndexOffset + 0);
-  this->indices.push_back(vertexIndexOffset + 1);
-  this->indices.push_back(vertexIndexOffset + 2);
-  this->indices.push_back(vertexIndexOffset + 2);
-  this->indices.push_back(vertexIndexOffset + 1);
-  this->indices.push_back(vertexIndexOffset + 3);
+  // rects do not sample a texture, so they can join any batch
+  const GLuint slot = SPRITE_BATCH_NO_TEXTURE;
+  this->vertices.push_back(Vertex(topLeft, uvTopLeft, color, slot));
+  this->vertices.push_back(Vertex(topRight, uvTopRight, color, slot));
+  this->vertices.push_back(Vertex(bottomLeft, uvBottomLeft, color, slot));
+  this->vertices.push_back(Vertex(bottomRight, uvBottomRight, color, slot));
+}
+
+void SpriteBatch::Append(std::span<const Vertex> quads, GLuint texture,
+                         uint8_t flags) {
+  size_t offset = 0;
+  while (offset < quads.size()) {
+    if (this->vertices.size() >= SPRITE_BATCH_MAX_SPRITES * 4) {
+      this->Flush();
+    }
+
+    // may flush, so the room left is only known afterwards
+    const GLuint slot = this->acquireTextureSlot(texture);
+    if (flags & SPRITE_BATCH_SDF_TEXTURE) {
+      this->linearSlots |= 1u << slot;
+    }
+
+    const size_t count =
+        std::min(SPRITE_BATCH_MAX_SPRITES * 4 - this->vertices.size(),
+                 quads.size() - offset);
+    const size_t first = this->vertices.size();
+    this->vertices.insert(this->vertices.end(), quads.begin() + offset,
+                          quads.begin() + offset + count);
+
+    const uint8_t textureIndex = slot | flags;
+    for (size_t i = first; i < this->vertices.size(); i++) {
+      this->vertices[i].textureIndex = textureIndex;
+    }
+    offset += count;
+  }
 }
 
 void SpriteBatch::Flush() {
@@ -236,65 +406,155 @@ void SpriteBatch::Flush() {
     return;
   }
 
+  FlushState state;
+  std::copy_n(this->textures, this->textureCount, state.textures);
+  state.textureCount = this->textureCount;
+  state.linearSlots = this->linearSlots;
+  state.projection = this->projection;
+  state.view = this->view;
+  state.textOutline = this->textOutline;
+  state.textOutlineColor = this->textOutlineColor;
+
+  if (RenderThread::IsThreaded()) {
+    // the render thread takes the recorded vertices and hands the vector back
+    // once drawn, recording continues in one it handed back before
+    RenderThread::Submit(
+        [this, state, vertices = std::move(this->vertices)]() mutable {
+          this->draw(vertices, state);
+          vertices.clear();
+          std::lock_guard<std::mutex> lock(this->spareMutex);
+          this->spareVertices.push_back(std::move(vertices));
+        });
+
+    std::lock_guard<std::mutex> lock(this->spareMutex);
+    if (!this->spareVertices.empty()) {
+      this->vertices = std::move(this->spareVertices.back());
+      this->spareVertices.pop_back();
+    } else {
+      this->vertices.reserve(SPRITE_BATCH_MAX_SPRITES * 4);
+    }
+  } else {
+    this->draw(this->vertices, state);
+  }
+
+  this->vertices.clear();
+  this->textureCount = 0;
+  this->linearSlots = 0;
+}
+
+void SpriteBatch::draw(std::span<const Vertex> vertices,
+                       const FlushState &state) {
+  PROFILE_ZONE("SpriteBatch::Flush");
+
   glUseProgram(this->shaderProgram);
+  RenderStats::CountProgramSwitch();
   glBindVertexArray(this->vao); // Bind the VAO
 
-  GLuint whiteTexture;
-
-  if (this->texture == NULL) {
-    // If the texture is undefined, bind a 1x1 white texture
-    glGenTextures(1, &whiteTexture);
-    glBindTexture(GL_TEXTURE_2D, whiteTexture);
-    unsigned char whitePixel[] = {255, 255, 255, 255}; // White color
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                 whitePixel);
-    glUniform1i(this->textureUniform, 0);
-  } else {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, this->texture);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glUniform1i(this->textureUniform, 0);
+  // bind every texture used by the batch to the unit matching its slot
+  for (size_t i = 0; i < state.textureCount; i++) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, state.textures[i]);
+    RenderStats::CountTextureBind();
+    glBindSampler(i, (state.linearSlots >> i) & 1 ? this->linearSampler
+                                                  : this->sampler);
   }
+  glActiveTexture(GL_TEXTURE0);
 
   // Upload the vertex data to the GPU
-  glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
-  glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex),
-               &this->vertices[0], GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  const size_t spriteCount = vertices.size() / 4;
+  const size_t firstSprite = this->reserveSprites(spriteCount);
+  const size_t vertexBytes = vertices.size() * sizeof(Vertex);
+  const GLintptr vertexOffset = firstSprite * 4 * sizeof(Vertex);
 
-  // Upload the index data to the GPU
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint),
-               &this->indices[0], GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+#ifdef EMSCRIPTEN
+  // webgl has no buffer mapping, sub data is a copy on the js side anyway
+  glBufferSubData(GL_ARRAY_BUFFER, vertexOffset, vertexBytes,
+                  vertices.data());
+#else
+  // the region is fenced, so we can write without the driver synchronizing
+  void *dst = glMapBufferRange(GL_ARRAY_BUFFER, vertexOffset, vertexBytes,
+                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                   GL_MAP_UNSYNCHRONIZED_BIT);
+  if (dst != nullptr) {
+    memcpy(dst, vertices.data(), vertexBytes);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+  }
+#endif
   glBindBuffer(GL_ARRAY_BUFFER, 0);
+  RenderStats::CountBufferBytes(vertexBytes);
 
   glUniformMatrix4fv(this->projectionUniform, 1, GL_FALSE,
-                     glm::value_ptr(this->projection));
+                     glm::value_ptr(state.projection));
 
   glUniformMatrix4fv(this->viewUniform, 1, GL_FALSE,
-                     glm::value_ptr(this->view));
+                     glm::value_ptr(state.view));
 
-  glEnableVertexAttribArray(0); // position
-  glEnableVertexAttribArray(1); // uv
-  glEnableVertexAttribArray(2); // color
-  glEnableVertexAttribArray(3); // rotation
+  glUniform2fv(this->textOutlineUniform, 1,
+               glm::value_ptr(state.textOutline));
+  glUniform4fv(this->textOutlineColorUniform, 1,
+               glm::value_ptr(state.textOutlineColor));
 
-  glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+  // the static indices for sprite slot n reference vertices 4n to 4n + 3, so
+  // starting at the first reserved slot draws the vertices we just wrote
+  glDrawElements(GL_TRIANGLES, spriteCount * 6, GL_UNSIGNED_SHORT,
+                 (GLvoid *)(firstSprite * 6 * sizeof(GLushort)));
+  RenderStats::CountDrawCall();
 
-  glDisableVertexAttribArray(0); // position
-  glDisableVertexAttribArray(1); // uv
-  glDisableVertexAttribArray(2); // color
-  glDisableVertexAttribArray(3); // rotation
+  glBindVertexArray(0); // Unbind the VAO
+}
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // Unbind the EBO
-  glBindVertexArray(0);                     // Unbind the VAO
-  this->vertices.clear();
-  this->indices.clear();
-  if (this->texture == NULL) {
-    // Delete the temporary white texture if it was created
-    glDeleteTextures(1, &whiteTexture);
+GLuint SpriteBatch::acquireTextureSlot(GLuint texture) {
+  for (size_t i = 0; i < this->textureCount; i++) {
+    if (this->textures[i] == texture) {
+      return i;
+    }
+  }
+
+  if (this->textureCount == SPRITE_BATCH_MAX_TEXTURES) {
+    this->Flush();
+  }
+
+  this->textures[this->textureCount] = texture;
+  return this->textureCount++;
+}
+
+size_t SpriteBatch::reserveSprites(size_t count) {
+  const size_t region = this->bufferCursor / SPRITE_BATCH_MAX_SPRITES;
+  const size_t regionOffset = this->bufferCursor % SPRITE_BATCH_MAX_SPRITES;
+
+  // a batch never spans regions, move on to the next one if it does not fit
+  if (regionOffset + count > SPRITE_BATCH_MAX_SPRITES) {
+    const size_t nextRegion = (region + 1) % SPRITE_BATCH_BUFFER_REGIONS;
+
+#ifndef EMSCRIPTEN
+    // fence everything drawn from the region we are leaving
+    if (this->regionFences[region] != nullptr) {
+      glDeleteSync(this->regionFences[region]);
+    }
+    this->regionFences[region] =
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // wait until the GPU is done with the region we are about to overwrite,
+    // with three regions this is almost always already signaled
+    GLsync fence = this->regionFences[nextRegion];
+    if (fence != nullptr) {
+      GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  1000000); // 1ms
+      }
+      glDeleteSync(fence);
+      this->regionFences[nextRegion] = nullptr;
+    }
+#endif
+
+    this->bufferCursor = nextRegion * SPRITE_BATCH_MAX_SPRITES;
   }
+
+  const size_t first = this->bufferCursor;
+  this->bufferCursor += count;
+  return first;
 }
 
 void SpriteBatch::SetProjection(glm::vec2 windowSize) {
@@ -306,7 +566,20 @@ void SpriteBatch::SetProjection(glm::vec2 windowSize) {
 }
 
 void SpriteBatch::SetTextureAndDimensions(GLuint texture, const int w,
-                                          const int h) {
+                                          const int h, uint8_t flags) {
   this->texture = texture;
   this->textureRect = glm::ivec4(0, 0, w, h);
+  this->textureFlags = flags;
+}
+
+void SpriteBatch::SetTextOutline(float width, float softness,
+                                 glm::vec4 color) {
+  const glm::vec2 outline = glm::vec2(width, softness);
+  if (outline == this->textOutline && color == this->textOutlineColor) {
+    return;
+  }
+  // the outline is a uniform, text already queued keeps the old one
+  this->Flush();
+  this->textOutline = outline;
+  this->textOutlineColor = color;
 }
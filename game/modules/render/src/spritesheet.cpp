@@ -1,9 +1,25 @@
 #include "spritesheet.hpp"
-#include <fstream>
+#include <archive.hpp>
 #include <nlohmann/json.hpp>
 #include <utils.hpp>
 
-SpriteSheet::SpriteSheet(const char *atlasPath) { this->loadAtlas(atlasPath); }
+SpriteSheet::SpriteSheet(const char *atlasPath) {
+  AssetBlob blob;
+  if (!AssetArchive::Open(atlasPath, &blob)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "SpriteSheet: could not open %s", atlasPath);
+  }
+
+  // get the path (without file) from the atlas path
+  const std::string atlasPathStr = atlasPath;
+  this->loadAtlas(blob.data,
+                  atlasPathStr.substr(0, atlasPathStr.find_last_of("/")));
+}
+
+SpriteSheet::SpriteSheet(std::span<const uint8_t> atlasJson,
+                         const char *atlasDir) {
+  this->loadAtlas(atlasJson, atlasDir);
+}
 
 SpriteSheet::~SpriteSheet() {}
 
@@ -39,50 +55,81 @@ SpriteAnimation *SpriteSheet::GetAnimation(const char *name) {
   return &this->animations["default"];
 }
 
+size_t SpriteSheet::GetCPUBytes() const {
+  size_t bytes = sizeof(SpriteSheet) + this->atlas.size() * sizeof(int);
+  for (const auto &animation : this->animations) {
+    bytes += animation.first.size() + sizeof(SpriteAnimation) +
+             animation.second.frames.size() * sizeof(int);
+  }
+  return bytes;
+}
+
+size_t SpriteSheet::GetGPUBytes() const {
+  return this->texture ? this->texture->GetGPUBytes() : 0;
+}
+
 glm::vec4 SpriteSheet::GetAnimationRect(const SpriteAnimation *animation,
                                         size_t index) {
   return this->GetAtlasRect(animation->frames[index]);
 }
 
-void SpriteSheet::loadAtlas(const char *atlasPath) {
-  std::vector<SDL_Rect> rects;
-  std::ifstream atlasFile(atlasPath);
-  nlohmann::json atlasJson;
-  atlasFile >> atlasJson;
+bool SpriteSheet::ParseAtlas(std::span<const uint8_t> atlasJson,
+                             SpriteAtlasData *out) {
+  nlohmann::json json =
+      nlohmann::json::parse(atlasJson.begin(), atlasJson.end(), nullptr, false);
+  if (json.is_discarded()) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "SpriteSheet: could not parse atlas json");
+    return false;
+  }
 
-  // get the path (without file) from the atlas path
-  const std::string atlasPathStr = atlasPath;
-  const std::string atlasDir =
-      atlasPathStr.substr(0, atlasPathStr.find_last_of("/"));
+  out->texturePath = json["texture"];
 
-  // load the texture
-  const std::string texturePath = atlasJson["texture"];
-  const std::string textureFullPath = (atlasDir + "/" + texturePath).c_str();
-  this->texture = std::make_shared<Texture>(textureFullPath.c_str());
-  SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Texture loaded");
+  // the atlas is a single vector of ints
+  out->atlas = json["atlas"].get<std::vector<int>>();
+  if (out->atlas.size() < 4) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "SpriteSheet: atlas has no sprites");
+    return false;
+  }
 
-  // load the atlas into memory as a single vector of ints
-  std::vector<int> temp = atlasJson["atlas"];
-  this->atlas = temp;
-  this->numRects = temp.size() / 4;
+  // get the wh (dimensions) of a frame
+  const auto frameDimensions = [&](size_t index) {
+    if (index * 4 + 3 >= out->atlas.size()) {
+      index = 0;
+    }
+    return glm::vec2(out->atlas[index * 4 + 2], out->atlas[index * 4 + 3]);
+  };
 
   // load the animations
-  nlohmann::json animations = atlasJson["animations"];
-  for (auto &animation : animations.items()) {
-    const std::string name = animation.key();
+  out->animations.clear();
+  for (auto &animation : json["animations"].items()) {
     const std::vector<int> frames = animation.value()["frames"];
     const float frameTime = animation.value()["frameTime"];
     const bool loop = animation.value()["loop"];
 
-    // get the wh (dimensions) of the first frame
-
-    const glm::vec4 rect = this->GetAtlasRect(frames[0]);
-    const glm::vec2 dimensions = glm::vec2(rect.z, rect.w);
+    out->animations[animation.key()] =
+        SpriteAnimation(frames, frameTime, frameDimensions(frames[0]), loop);
+  }
+  out->animations["default"] =
+      SpriteAnimation({0}, 0.0f, frameDimensions(0), false);
+  return true;
+}
 
-    this->animations[name] =
-        SpriteAnimation(frames, frameTime, dimensions, loop);
+void SpriteSheet::loadAtlas(std::span<const uint8_t> atlasData,
+                            const std::string &atlasDir) {
+  SpriteAtlasData data;
+  if (!SpriteSheet::ParseAtlas(atlasData, &data)) {
+    this->numRects = 0;
+    return;
   }
-  const glm::vec4 rect = this->GetAtlasRect(0);
-  const glm::vec2 dimensions = glm::vec2(rect.z, rect.w);
-  this->animations["default"] = SpriteAnimation({0}, 0.0f, dimensions, false);
+
+  // load the texture
+  const std::string textureFullPath = atlasDir + "/" + data.texturePath;
+  this->texture = std::make_shared<Texture>(textureFullPath.c_str());
+  SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Texture loaded");
+
+  this->atlas = std::move(data.atlas);
+  this->numRects = this->atlas.size() / 4;
+  this->animations = std::move(data.animations);
 }
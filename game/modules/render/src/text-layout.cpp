@@ -0,0 +1,37 @@
+#include "text-layout.hpp"
+
+bool TextLayout::Set(Font *font, std::string_view text, glm::vec2 position,
+                     glm::vec2 scale, glm::vec4 color, float wrapWidth) {
+  if (font == this->font && text == this->text &&
+      position == this->position && scale == this->scale &&
+      color == this->color && wrapWidth == this->wrapWidth) {
+    return false;
+  }
+
+  this->font = font;
+  this->text = text;
+  this->position = position;
+  this->scale = scale;
+  this->color = color;
+  this->wrapWidth = wrapWidth;
+
+  // clear keeps the capacity, a counter that changes every few frames does
+  // not allocate
+  this->vertices.clear();
+  this->runs.clear();
+  this->dimensions = glm::vec2(0.0f);
+  if (font != nullptr) {
+    this->dimensions =
+        font->BuildText(this->text.c_str(), position, scale, color, wrapWidth,
+                        &this->vertices, &this->runs);
+  }
+  return true;
+}
+
+void TextLayout::Draw(SpriteBatch *renderer) const {
+  for (const TextRun &run : this->runs) {
+    renderer->Append(
+        std::span<const Vertex>(&this->vertices[run.first], run.count),
+        run.texture, run.flags);
+  }
+}
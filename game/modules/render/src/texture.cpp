@@ -1,79 +1,211 @@
 #include "texture.hpp"
+#include "etc2.hpp"
+#include "ktx2.hpp"
+#include "render-thread.hpp"
 #include <SDL.h>
+#include <algorithm>
+#include <archive.hpp>
+#include <cstring>
 
 #ifdef EMSCRIPTEN
 #include <SDL_image.h> // stb_image ahould be supported in emscripten, not sure why it's not working
 
-Texture::Texture(const char *filename) {
+static bool decodeImage(std::span<const uint8_t> data, ImageData *out) {
   // Load image using SDL_image
-  SDL_Log("Loading texture: %s", filename);
-  SDL_Surface *surface = IMG_Load(filename);
-  this->w = surface->w;
-  this->h = surface->h;
-  if (!surface) {
+  SDL_Surface *loaded =
+      IMG_Load_RW(SDL_RWFromConstMem(data.data(), data.size()), 1);
+  if (!loaded) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load texture: %s",
                  IMG_GetError());
-
-    // Free the surface
-    SDL_FreeSurface(surface);
-    return;
+    return false;
   }
+  // make sure the pixels are tightly packed RGBA bytes
+  SDL_Surface *surface =
+      SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(loaded);
+  if (!surface) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to convert texture: %s",
+                 SDL_GetError());
+    return false;
+  }
+  out->w = surface->w;
+  out->h = surface->h;
 
-  glGenTextures(1, &this->texture);
-  glBindTexture(GL_TEXTURE_2D, this->texture);
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surface->w, surface->h, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, surface->pixels);
-
-  // Set texture parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  const size_t size = (size_t)surface->w * surface->h * 4;
+  out->pixels.resize(size);
+  memcpy(out->pixels.data(), surface->pixels, size);
 
-  // Unbind the texture
-  glBindTexture(GL_TEXTURE_2D, 0);
-  // Free the surfaces
+  // Free the surface
   SDL_FreeSurface(surface);
+  return true;
 }
 
 #endif
 #ifndef EMSCRIPTEN
 #include "stb_image.h"
 
-Texture::Texture(const char *filename) {
+static bool decodeImage(std::span<const uint8_t> data, ImageData *out) {
   // Load image using stb_image
   int w, h, channels;
-  unsigned char *image = stbi_load(filename, &w, &h, &channels, STBI_rgb_alpha);
+  unsigned char *image = stbi_load_from_memory(
+      data.data(), data.size(), &w, &h, &channels, STBI_rgb_alpha);
   if (!image) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load texture: %s",
                  stbi_failure_reason());
-    return;
+    return false;
+  }
+  out->w = w;
+  out->h = h;
+  out->pixels.assign(image, image + (size_t)w * h * 4);
+
+  // Free the image data
+  stbi_image_free(image);
+  return true;
+}
+
+#endif
+
+bool Texture::Decode(std::span<const uint8_t> data, ImageData *out) {
+  if (IsKTX2(data)) {
+    return ParseKTX2(data, out);
+  }
+  return decodeImage(data, out);
+}
+
+bool Texture::Decode(const char *filename, ImageData *out) {
+  SDL_Log("Loading texture: %s", filename);
+
+  // prefer the cooked sibling produced by the texture cooker, it carries the
+  // compressed mip chain. the source image does not have to ship with it
+  const std::string path = filename;
+  const std::string cookedPath = GetCookedTexturePath(path);
+  AssetBlob cooked;
+  if (cookedPath != path && AssetArchive::Open(cookedPath, &cooked) &&
+      IsKTX2(cooked.data)) {
+    if (ParseKTX2(cooked.data, out)) {
+      SDL_Log("Texture: Loading cooked texture for %s", filename);
+      return true;
+    }
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                "Texture: Ignoring corrupt cooked texture for %s", filename);
+    *out = ImageData();
   }
-  this->w = w;
-  this->h = h;
+
+  AssetBlob blob;
+  if (!AssetArchive::Open(filename, &blob)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open texture: %s",
+                 filename);
+    return false;
+  }
+  return Decode(blob.data, out);
+}
+
+Texture::Texture(const char *filename) {
+  ImageData image;
+  if (Decode(filename, &image)) {
+    RenderThread::Call([&]() { this->upload(image); });
+  }
+}
+
+Texture::Texture(std::span<const uint8_t> data) {
+  ImageData image;
+  if (Decode(data, &image)) {
+    RenderThread::Call([&]() { this->upload(image); });
+  }
+}
+
+Texture::Texture(const ImageData &image) {
+  if (!image.pixels.empty()) {
+    RenderThread::Call([&]() { this->upload(image); });
+  }
+}
+
+// WebGL only lists ETC2 when the extension is there
+static std::vector<GLint> compressedFormats;
+static bool compressedFormatsQueried = false;
+
+void Texture::QueryCompressedFormats() {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+  compressedFormats.resize(count);
+  if (count > 0) {
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, compressedFormats.data());
+  }
+  compressedFormatsQueried = true;
+}
+
+static bool supportsFormat(GLenum format) {
+  if (!compressedFormatsQueried) {
+    Texture::QueryCompressedFormats();
+  }
+  return std::find(compressedFormats.begin(), compressedFormats.end(),
+                   (GLint)format) != compressedFormats.end();
+}
+
+void Texture::upload(const ImageData &image) {
+  this->w = image.w;
+  this->h = image.h;
 
   glGenTextures(1, &this->texture);
   glBindTexture(GL_TEXTURE_2D, this->texture);
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-               image);
+  if (image.compressedFormat != 0) {
+    this->uploadCompressed(image);
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.w, image.h, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, image.pixels.data());
+    this->gpuBytes = (size_t)image.w * image.h * 4;
+  }
+
+  // only the levels that were uploaded are sampled
+  const int levels = std::max<int>(image.levels.size(), 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
 
   // Set texture parameters
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
   // Unbind the texture
   glBindTexture(GL_TEXTURE_2D, 0);
-  // Free the image data
-  stbi_image_free(image);
 }
 
-#endif
+void Texture::uploadCompressed(const ImageData &image) {
+  this->gpuBytes = 0;
+  if (supportsFormat(image.compressedFormat)) {
+    for (size_t i = 0; i < image.levels.size(); i++) {
+      const ImageLevel &level = image.levels[i];
+      glCompressedTexImage2D(GL_TEXTURE_2D, i, image.compressedFormat, level.w,
+                             level.h, 0, level.size,
+                             &image.pixels[level.offset]);
+      this->gpuBytes += level.size;
+    }
+    return;
+  }
+
+  // the driver can not sample ETC2, transcode every level to RGBA8 instead
+  SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+              "Texture: ETC2 is not supported, transcoding to RGBA8");
+  std::vector<uint8_t> pixels;
+  for (size_t i = 0; i < image.levels.size(); i++) {
+    const ImageLevel &level = image.levels[i];
+    pixels.resize((size_t)level.w * level.h * 4);
+    DecodeETC2Image(&image.pixels[level.offset], level.w, level.h,
+                    pixels.data());
+    glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level.w, level.h, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, pixels.data());
+    this->gpuBytes += pixels.size();
+  }
+}
 
-Texture::~Texture() { glDeleteTextures(1, &this->texture); }
+Texture::~Texture() {
+  if (this->texture != 0) {
+    RenderThread::Submit(
+        [texture = this->texture]() { glDeleteTextures(1, &texture); });
+  }
+}
 
 GLuint Texture::GetGLTexture() { return this->texture; }
 
@@ -0,0 +1,139 @@
+#pragma once
+
+// minimal 4 wide float vector over SSE2, NEON and wasm simd128 with a scalar
+// fallback, only what the hot loops need
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define SIMD_WASM 1
+#include <wasm_simd128.h>
+#endif
+
+#include <cstdint>
+
+namespace simd {
+
+#if defined(SIMD_SSE2)
+typedef __m128 float4;
+
+inline float4 Load(const float *p) { return _mm_loadu_ps(p); }
+inline float4 Set(float x, float y, float z, float w) {
+  return _mm_setr_ps(x, y, z, w);
+}
+inline float4 Splat(float v) { return _mm_set1_ps(v); }
+inline void Store(float *p, float4 v) { _mm_storeu_ps(p, v); }
+inline float4 Add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 Mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 Min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+inline float4 Max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+inline float4 Abs(float4 v) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+// (x, y, x, y) and (z, w, z, w)
+inline float4 XYXY(float4 v) { return _mm_movelh_ps(v, v); }
+inline float4 ZWZW(float4 v) { return _mm_movehl_ps(v, v); }
+// truncating conversion, add 0.5 first to round positive values
+inline void StoreInt(int32_t *p, float4 v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_cvttps_epi32(v));
+}
+
+#elif defined(SIMD_NEON)
+typedef float32x4_t float4;
+
+inline float4 Load(const float *p) { return vld1q_f32(p); }
+inline float4 Set(float x, float y, float z, float w) {
+  const float values[4] = {x, y, z, w};
+  return vld1q_f32(values);
+}
+inline float4 Splat(float v) { return vdupq_n_f32(v); }
+inline void Store(float *p, float4 v) { vst1q_f32(p, v); }
+inline float4 Add(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 Mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+inline float4 Min(float4 a, float4 b) { return vminq_f32(a, b); }
+inline float4 Max(float4 a, float4 b) { return vmaxq_f32(a, b); }
+inline float4 Abs(float4 v) { return vabsq_f32(v); }
+inline float4 XYXY(float4 v) {
+  return vcombine_f32(vget_low_f32(v), vget_low_f32(v));
+}
+inline float4 ZWZW(float4 v) {
+  return vcombine_f32(vget_high_f32(v), vget_high_f32(v));
+}
+inline void StoreInt(int32_t *p, float4 v) { vst1q_s32(p, vcvtq_s32_f32(v)); }
+
+#elif defined(SIMD_WASM)
+typedef v128_t float4;
+
+inline float4 Load(const float *p) { return wasm_v128_load(p); }
+inline float4 Set(float x, float y, float z, float w) {
+  return wasm_f32x4_make(x, y, z, w);
+}
+inline float4 Splat(float v) { return wasm_f32x4_splat(v); }
+inline void Store(float *p, float4 v) { wasm_v128_store(p, v); }
+inline float4 Add(float4 a, float4 b) { return wasm_f32x4_add(a, b); }
+inline float4 Mul(float4 a, float4 b) { return wasm_f32x4_mul(a, b); }
+inline float4 Min(float4 a, float4 b) { return wasm_f32x4_pmin(a, b); }
+inline float4 Max(float4 a, float4 b) { return wasm_f32x4_pmax(a, b); }
+inline float4 Abs(float4 v) { return wasm_f32x4_abs(v); }
+inline float4 XYXY(float4 v) { return wasm_i32x4_shuffle(v, v, 0, 1, 0, 1); }
+inline float4 ZWZW(float4 v) { return wasm_i32x4_shuffle(v, v, 2, 3, 2, 3); }
+inline void StoreInt(int32_t *p, float4 v) {
+  wasm_v128_store(p, wasm_i32x4_trunc_sat_f32x4(v));
+}
+
+#else
+struct float4 {
+  float v[4];
+};
+
+inline float4 Load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline float4 Set(float x, float y, float z, float w) {
+  return {{x, y, z, w}};
+}
+inline float4 Splat(float v) { return {{v, v, v, v}}; }
+inline void Store(float *p, float4 a) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = a.v[i];
+  }
+}
+inline float4 Add(float4 a, float4 b) {
+  return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+inline float4 Mul(float4 a, float4 b) {
+  return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+inline float4 Min(float4 a, float4 b) {
+  float4 r;
+  for (int i = 0; i < 4; i++) {
+    r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+  }
+  return r;
+}
+inline float4 Max(float4 a, float4 b) {
+  float4 r;
+  for (int i = 0; i < 4; i++) {
+    r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+  }
+  return r;
+}
+inline float4 Abs(float4 a) {
+  float4 r;
+  for (int i = 0; i < 4; i++) {
+    r.v[i] = a.v[i] < 0.0f ? -a.v[i] : a.v[i];
+  }
+  return r;
+}
+inline float4 XYXY(float4 a) { return {{a.v[0], a.v[1], a.v[0], a.v[1]}}; }
+inline float4 ZWZW(float4 a) { return {{a.v[2], a.v[3], a.v[2], a.v[3]}}; }
+inline void StoreInt(int32_t *p, float4 a) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = (int32_t)a.v[i];
+  }
+}
+#endif
+
+} // namespace simd
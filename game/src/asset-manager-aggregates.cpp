@@ -2,6 +2,7 @@
 #include <asset-manager.hpp>
 #include <font.hpp>
 #include <mixer.hpp>
+#include <model.hpp>
 #include <spritesheet.hpp>
 #include <texture.hpp>
 
@@ -11,6 +12,7 @@ void LockAllAssets() {
   AssetManager<Music>::lockAll();
   AssetManager<SoundEffect>::lockAll();
   AssetManager<SpriteSheet>::lockAll();
+  AssetManager<Model>::lockAll();
 }
 
 void UnlockAllAssets() {
@@ -19,4 +21,7 @@ void UnlockAllAssets() {
   AssetManager<Music>::unlockAll();
   AssetManager<SoundEffect>::unlockAll();
   AssetManager<SpriteSheet>::unlockAll();
+  AssetManager<Model>::unlockAll();
 }
+
+void SetAssetBudget(size_t bytes) { AssetResidency::SetBudget(bytes); }
@@ -2,9 +2,16 @@
 #include "resource-paths.hpp"
 
 #include <SDL.h>
+#include <archive.hpp>
 #include <asset-manager.hpp>
+#include <filesystem>
+#include <frame-graph.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <input.hpp>
+#include <mic-level.hpp>
+#include <profiler.hpp>
+#include <render-stats.hpp>
+#include <render-thread.hpp>
 
 static Game *game; // this is dirty but it works for now
 
@@ -17,13 +24,19 @@ static int loaded_timestamp = 0;
 CR_EXPORT int cr_main(struct cr_plugin *ctx, enum cr_op operation) {
   assert(ctx);
 
-  gladLoadGLES2Loader((GLADloadproc)SDL_GL_GetProcAddress);
+  SharedData *shared_data = (SharedData *)ctx->userdata;
   // get a random int
   switch (operation) {
   case CR_LOAD:
+    // record into the host's command stream, the context may live on its
+    // render thread and may not be an SDL one (headless)
+    RenderThread::Attach(shared_data->render_thread);
+    RenderThread::Call([shared_data]() {
+      gladLoadGLES2Loader((GLADloadproc)shared_data->gl_get_proc_address);
+    });
     loaded_timestamp = SDL_GetTicks();
     game = new Game();
-    game->init((SharedData *)ctx->userdata);
+    game->init(shared_data);
     return printf("loaded %i\n", loaded_timestamp);
   case CR_UNLOAD:
     game->unload();
@@ -31,6 +44,8 @@ CR_EXPORT int cr_main(struct cr_plugin *ctx, enum cr_op operation) {
   case CR_CLOSE:
     game->close();
     delete game;
+    // the destructors queued deletes that run code from this library
+    RenderThread::Drain();
     return printf("closed %i\n", loaded_timestamp);
   case CR_STEP:
     return game->update();
@@ -45,38 +60,57 @@ Game::~Game() {}
 
 int Game::init(SharedData *shared_data) {
   SDL_Log("Game init");
-  SDL_SetWindowTitle(SDL_GL_GetCurrentWindow(), "Turboballs");
+  // record into the host's profiler, zones from this library and the host
+  // then share one timeline across reloads
+  Profiler::Attach(shared_data->profiler);
+  RenderStats::Attach(shared_data->render_stats);
+  // the context is current on the render thread, ask there for its window
+  SDL_Window *window = nullptr;
+  RenderThread::Call([&window]() { window = SDL_GL_GetCurrentWindow(); });
+  if (window != nullptr) {
+    SDL_SetWindowTitle(window, "Turboballs");
+  }
+  this->sharedData = shared_data;
 
   // map the text_input_buffer
   InputManager::SetTextInputBuffer(&shared_data->text_input_buffer[0]);
-  InputManager::SetInputVolumeRef(shared_data->input_volume);
+  MicLevel::Attach(shared_data->mic_level);
+  // read assets from the packed archive when the build produced one
+  if (std::filesystem::exists(RES_ARCHIVE)) {
+    AssetArchive::Mount(std::make_shared<AssetArchive>(RES_ARCHIVE));
+  }
+
   // Get current window size
-  int w, h;
-  SDL_GetWindowSize(SDL_GL_GetCurrentWindow(), &w, &h);
+  const int w = shared_data->window_width;
+  const int h = shared_data->window_height;
   this->spriteBatcher = std::make_unique<SpriteBatch>(glm::vec2(w, h));
 
   this->meshRenderer = std::make_unique<MeshRenderer>();
 
   this->mixer = std::make_unique<Mixer>();
 
-  this->font = AssetManager<Font>::getFont(RES_FONT_CYBERDYNE, 32);
-  this->fontBig = AssetManager<Font>::getFont(RES_FONT_CYBERDYNE, 60);
+  this->windowSize = glm::vec2(w, h);
+
+  // load everything in the background, update shows a loading screen until
+  // all of it is ready
+  this->fontHandle = AssetManager<Font>::getFontAsync(
+      RES_FONT_CYBERDYNE, FONT_SDF_SIZE, FontMode::SDF);
 
-  this->worldModel = AssetManager<Model>::get(RES_MODEL_VAPOR);
+  this->worldModelHandle = AssetManager<Model>::getAsync(RES_MODEL_VAPOR);
 
-  this->npcModel = AssetManager<Model>::get(RES_MODEL_POLY);
+  this->npcModelHandle = AssetManager<Model>::getAsync(RES_MODEL_POLY);
 
-  this->ballModel = AssetManager<Model>::get(RES_MODEL_BALL);
+  this->ballModelHandle = AssetManager<Model>::getAsync(RES_MODEL_BALL);
 
-  this->music = AssetManager<Music>::get(RES_MUSIC_TURBOBALLS);
+  this->musicHandle = AssetManager<Music>::getAsync(RES_MUSIC_TURBOBALLS);
 
   // set scale for player and enemy
   this->playerTransform = glm::scale(this->playerTransform, glm::vec3(5.0f));
   this->playerTransform[3].x = -this->ballMaxX;
   this->playerTransform[3].z = playerBallDestZ + 1.0f;
   this->enemyTransform = glm::scale(this->enemyTransform, glm::vec3(5.0f));
-
-  this->music->play_on_loop();
+  // nothing to interpolate from before the first tick
+  this->previousState = this->captureState();
 
   glm::vec2 center = glm::vec2(w / 2, h / 2);
   SDL_Rect bounds = {0, 0, w, h};
@@ -85,25 +119,77 @@ int Game::init(SharedData *shared_data) {
                                     bounds); // this is needed for sprites/text
 
   // set clear color to night dark blue
-  glClearColor(0.0f, 0.0f, 0.07f, 1.0f);
+  RenderThread::Submit([]() { glClearColor(0.0f, 0.0f, 0.07f, 1.0f); });
 
   return 0;
 }
 
-int Game::update() {
+bool Game::finishLoading() {
+  if (!this->fontHandle.IsReady() || !this->worldModelHandle.IsReady() ||
+      !this->npcModelHandle.IsReady() || !this->ballModelHandle.IsReady() ||
+      !this->musicHandle.IsReady()) {
+    return false;
+  }
 
-  float time = SDL_GetTicks() / 1000.0f;
-  float delta = time - this->lastTime;
-  this->lastTime = time;
+  this->font = this->fontHandle.Get();
+  this->worldModel = this->worldModelHandle.Get();
+  this->npcModel = this->npcModelHandle.Get();
+  this->ballModel = this->ballModelHandle.Get();
+  this->music = this->musicHandle.Get();
+
+  this->music->play_on_loop();
+
+  SDL_Log("Loading finished in %u ms", SDL_GetTicks());
+  return true;
+}
+
+void Game::drawLoadingScreen() {
+  const int total = 5;
+  const int loaded =
+      this->fontHandle.IsReady() + this->worldModelHandle.IsReady() +
+      this->npcModelHandle.IsReady() + this->ballModelHandle.IsReady() +
+      this->musicHandle.IsReady();
+
+  // progress bar in the middle of the screen
+  const glm::vec2 size = glm::vec2(this->windowSize.x * 0.5f, 16.0f);
+  const glm::vec2 origin = (this->windowSize - size) * 0.5f;
+  this->spriteBatcher->DrawRect(glm::vec4(origin.x, origin.y, size.x, size.y),
+                                glm::vec4(0.0f, 0.2f, 0.2f, 1.0f));
+  this->spriteBatcher->DrawRect(
+      glm::vec4(origin.x, origin.y, size.x * loaded / total, size.y),
+      glm::vec4(0.0f, 1.0f, 1.0f, 1.0f));
+  this->spriteBatcher->Flush();
+}
+
+int Game::update() {
+  PROFILE_ZONE("Game::update");
+
+  // finalize background loads, the uploads are spread over several frames
+  AssetLoader::Update(ASSET_LOAD_BUDGET_MS);
+  // release cached assets nobody uses once over the memory budget
+  AssetResidency::Trim();
+
+  if (this->isLoading) {
+    this->isLoading = !this->finishLoading();
+    if (this->isLoading) {
+      this->drawLoadingScreen();
+      return 0;
+    }
+  }
 
   // INPUT:
   int num_keys;
   const Uint8 *key_state = SDL_GetKeyboardState(&num_keys);
   InputManager::Update(key_state, num_keys);
 
+  if (InputManager::GetKey(SDL_SCANCODE_F3).IsJustPressed()) {
+    this->showFrameGraph = !this->showFrameGraph;
+  }
+
   // if enter is pressed toggle isPlaying
   if (!this->isPlaying &&
-      InputManager::GetKey(SDL_SCANCODE_RETURN).IsJustPressed()) {
+      (this->sharedData->autoplay ||
+       InputManager::GetKey(SDL_SCANCODE_RETURN).IsJustPressed())) {
     this->score = 0;
     this->isPlaying = !this->isPlaying;
   }
@@ -112,12 +198,154 @@ int Game::update() {
   const float clamp_volume =
       glm::clamp(InputManager::GetInputVolume(), 0.0f, 1.0f);
 
+  // LOGIC:
+
+  // the simulation advances in fixed ticks whatever the frame rate, a fixed
+  // frame time (--fixed-dt) replaces the clock so every run plays the same
+  const Uint64 counter = SDL_GetPerformanceCounter();
+  float frameTime = this->sharedData->fixed_dt;
+  if (frameTime <= 0.0f) {
+    frameTime = this->lastCounter == 0
+                    ? 0.0f
+                    : (float)(counter - this->lastCounter) /
+                          SDL_GetPerformanceFrequency();
+  }
+  this->lastCounter = counter;
+  // after a stall drop the time instead of running a burst of ticks
+  frameTime = glm::min(frameTime, GAME_MAX_FRAME_TIME);
+  this->lastTime += frameTime;
+
+  const int tickRate = this->sharedData->tick_rate > 0
+                           ? this->sharedData->tick_rate
+                           : GAME_TICK_RATE;
+  const float tickDt = 1.0f / tickRate;
+  this->accumulator += frameTime;
+  while (this->accumulator >= tickDt) {
+    this->previousState = this->captureState();
+    this->tick(tickDt, clamp_volume);
+    this->accumulator -= tickDt;
+  }
+
+  // draw between the last two ticks, how far is the time left over
+  const float alpha = this->accumulator / tickDt;
+  const SimulationState currentState = this->captureState();
+  const auto lerp = [&](float a, float b) { return a + (b - a) * alpha; };
+
+  const glm::vec3 ballPos =
+      glm::mix(this->previousState.ballPos, currentState.ballPos, alpha);
+  glm::mat4 playerXform = this->playerTransform;
+  playerXform[3].x = lerp(this->previousState.playerX, currentState.playerX);
+  glm::mat4 enemyXform = this->enemyTransform;
+  enemyXform[3].x = lerp(this->previousState.enemyX, currentState.enemyX);
+
+  glm::vec3 camPos = this->camPos;
+  camPos.x = lerp(this->previousState.camX, currentState.camX);
+  this->meshRenderer->SetViewMatrix(
+      glm::lookAt(camPos, glm::vec3(0), this->camUp));
+
+  // RENDER:
+
+  // RENDER BACKGROUND TO A BUFFER TEXTURE:
+
+  for (const auto &mesh : this->worldModel->getMeshes()) {
+    this->meshRenderer->Submit(mesh.get(), mesh->model);
+  }
+
+  for (const auto &mesh : this->ballModel->getMeshes()) {
+    glm::mat4 xform = glm::translate(mesh->model, ballPos);
+    this->meshRenderer->Submit(mesh.get(), xform);
+  }
+
+  // RENDER TO A BLUR TEXTURE
+
+  // RENDER THE BACKGROUND TO THE SCREEN AS A SPRITE, USING THE BLUR TO POST
+  // PROCESS
+
+  // RENDER THE PLAYER, USING THE BLUR TO POST PROCESS
+
+  for (const auto &mesh : this->npcModel->getMeshes()) {
+    this->meshRenderer->Submit(mesh.get(), playerXform * mesh->model);
+  }
+
+  for (const auto &mesh : this->npcModel->getMeshes()) {
+    this->meshRenderer->Submit(mesh.get(), enemyXform * mesh->model);
+  }
+
+  // draw all queued meshes, sorted to minimize state changes
+  this->meshRenderer->Flush();
+
+  // RENDER THE TEXT, ALSO USING THE BLUR CUZ WHY NOT
+  const glm::vec2 hudScale = this->font->GetScale(FONT_SIZE_HUD);
+
+  // the layouts are only rebuilt when their text changes, formatting into a
+  // stack buffer keeps the per frame cost to a short compare
+  char text[32];
+  SpriteBatch *batch = this->spriteBatcher.get();
+
+  if (!isPlaying) {
+    // render every half second
+    if ((int)(this->lastTime * 1000.0f) % 1500 < 750) {
+      this->pauseText.Set(this->font.get(), "Press Enter to Play",
+                          glm::vec2(150, 300), hudScale,
+                          glm::vec4(0.7f, 1.0f, 0.93f, 0.8f));
+      this->pauseText.Draw(batch);
+    }
+
+    this->titleText.Set(this->font.get(), "Turboballs", glm::vec2(130, 200),
+                        this->font->GetScale(FONT_SIZE_TITLE),
+                        glm::vec4(0.0f, 1.0f, 1.0f, 1.0f));
+    batch->SetTextOutline(0.15f, 0.1f, glm::vec4(0.0f, 0.2f, 0.4f, 1.0f));
+    this->titleText.Draw(batch);
+    batch->SetTextOutline(0.0f);
+  } else {
+    snprintf(text, sizeof(text), "Mic: %.1f%%", clamp_volume * 100.0f);
+    this->micText.Set(this->font.get(), text, glm::vec2(0, 600 - 32),
+                      hudScale, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+    this->micText.Draw(batch);
+
+    snprintf(text, sizeof(text), "Score: %i", this->score);
+    this->scoreText.Set(this->font.get(), text, glm::vec2(0, 0), hudScale,
+                        glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+    this->scoreText.Draw(batch);
+
+    // render high score (top right)
+    snprintf(text, sizeof(text), "High Score: %i", this->highScore);
+    this->highScoreText.Set(this->font.get(), text, glm::vec2(420, 0),
+                            hudScale, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+    this->highScoreText.Draw(batch);
+  }
+
+  if (this->showFrameGraph) {
+    DrawFrameGraph(batch, glm::vec2(this->windowSize.x - 250, 40),
+                   glm::vec2(240, 80));
+
+    const RenderCounters stats = RenderStats::GetLastFrame();
+    snprintf(text, sizeof(text), "%u draws %u binds %lluKB", stats.drawCalls,
+             stats.textureBinds,
+             (unsigned long long)(stats.bufferBytes / 1024));
+    this->statsText.Set(this->font.get(), text,
+                        glm::vec2(this->windowSize.x - 250, 124),
+                        this->font->GetScale(FONT_SIZE_STATS),
+                        glm::vec4(1.0f, 1.0f, 1.0f, 0.8f));
+    this->statsText.Draw(batch);
+  }
+
+  // draw all sprites in the batch (note text is also a sprite)
+  this->spriteBatcher->Flush();
+
+  return 0;
+}
+
+SimulationState Game::captureState() const {
+  return {this->playerTransform[3].x, this->enemyTransform[3].x,
+          this->camPos.x, this->ballPos};
+}
+
+void Game::tick(float delta, float volume) {
   // get player x pos from transform
   float playerPosX = this->playerTransform[3].x;
   float enemyPosX = this->enemyTransform[3].x;
 
-  // LOGIC:
-
   if (isPlaying) {
     // increase t
     this->t += 0.4f * delta; // in one second t will be 0.4f
@@ -127,14 +355,12 @@ int Game::update() {
     // set player position (x) based off input volume
     // 0 is -maxX, 1 is maxX
     const float playerPosX =
-        (clamp_volume * this->ballMaxX * 2) - this->ballMaxX;
+        (volume * this->ballMaxX * 2) - this->ballMaxX;
     playerTransform[3].x = playerPosX;
 
     // CAMERA:
     // set the cam pos based off the player pos rel to max
     this->camPos.x = playerPosX / this->ballMaxX * this->camMaxX;
-    glm::mat4 view = glm::lookAt(this->camPos, glm::vec3(0), this->camUp);
-    this->meshRenderer->SetViewMatrix(view);
 
     if (ballEndPos.z == playerBallDestZ) {
       if (glm::distance(this->ballPos, glm::vec3(this->playerTransform[3])) <
@@ -168,99 +394,40 @@ int Game::update() {
           this->ballEndPos.z >= playerBallDestZ ? 0 : playerBallDestZ;
 
       // set ball emmision factor to a random color
-      this->ballModel->getMeshes()[0]->material->emissiveFactor =
+      const auto &ballMaterial = this->ballModel->getMeshes()[0]->material;
+      ballMaterial->emissiveFactor =
           glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f,
                     (rand() % 100) / 100.0f);
+      ballMaterial->MarkDirty();
 
       // set a random x pos for the ballEndPos (based on cam)
       this->ballEndPos.x = (rand() % (int)this->ballMaxX * 2) - this->ballMaxX;
     }
 
     // ENEMY:
-    // lerp the enemy z pos to always be the ballEndPos x
-    enemyPosX = glm::mix(enemyPosX, ballEndPos.x, t);
+    // lerp the enemy z pos to always be the ballEndPos x. the blend is per
+    // GAME_TICK_RATE tick, scaled to the tick length so the enemy closes in
+    // at the same speed whatever --tick-rate is
+    const float blend =
+        1.0f - glm::pow(1.0f - glm::clamp(this->t, 0.0f, 1.0f),
+                        delta * GAME_TICK_RATE);
+    enemyPosX = glm::mix(enemyPosX, ballEndPos.x, blend);
 
     enemyTransform[3].x = enemyPosX;
   }
+}
 
-  // RENDER:
-
-  // RENDER BACKGROUND TO A BUFFER TEXTURE:
-
-  for (const auto &mesh : this->worldModel->getMeshes()) {
-    this->meshRenderer->DrawMesh(mesh.get(), mesh->model);
-  }
-
-  for (const auto &mesh : this->ballModel->getMeshes()) {
-    glm::mat4 xform = glm::translate(mesh->model, this->ballPos);
-    this->meshRenderer->DrawMesh(mesh.get(), xform);
-  }
-
-  // RENDER TO A BLUR TEXTURE
-
-  // RENDER THE BACKGROUND TO THE SCREEN AS A SPRITE, USING THE BLUR TO POST
-  // PROCESS
-
-  // RENDER THE PLAYER, USING THE BLUR TO POST PROCESS
-
-  for (const auto &mesh : this->npcModel->getMeshes()) {
-    this->meshRenderer->DrawMesh(mesh.get(), playerTransform * mesh->model);
-  }
-
-  for (const auto &mesh : this->npcModel->getMeshes()) {
-    this->meshRenderer->DrawMesh(mesh.get(), enemyTransform * mesh->model);
-  }
-
-  // RENDER THE TEXT, ALSO USING THE BLUR CUZ WHY NOT
-
-  if (!isPlaying) {
-    // render every half second
-    if (SDL_GetTicks() % 1500 < 750) {
-      const std::string pause_text = "Press Enter to Play";
-      this->font->RenderText(this->spriteBatcher.get(), pause_text.c_str(),
-                             glm::vec2(150, 300), glm::vec2(1.0f),
-                             glm::vec4(0.7f, 1.0f, 0.93f, 0.8f));
-    }
-
-    this->spriteBatcher->Flush();
-
-    const std::string title = "Turboballs";
-    this->fontBig->RenderText(this->spriteBatcher.get(), title.c_str(),
-                              glm::vec2(130, 200), glm::vec2(1.0f),
-                              glm::vec4(0.0f, 1.0f, 1.0f, 1.0f));
-  } else {
-    char input_volume_percent_3_figures[6];
-    sprintf(input_volume_percent_3_figures, "%.1f", clamp_volume * 100.0f);
-
-    const std::string text =
-        "Mic: " + std::string(input_volume_percent_3_figures) + '%';
-
-    this->font->RenderText(this->spriteBatcher.get(), text.c_str(),
-                           glm::vec2(0, 600 - 32), glm::vec2(1.0f),
-                           glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
-
-    const std::string score_text = "Score: " + std::to_string(this->score);
-    this->font->RenderText(this->spriteBatcher.get(), score_text.c_str(),
-                           glm::vec2(0, 0), glm::vec2(1.0f),
-                           glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
-
-    const std::string high_score_text =
-        "High Score: " + std::to_string(this->highScore);
-    // render high score (top right)
-    this->font->RenderText(this->spriteBatcher.get(), high_score_text.c_str(),
-                           glm::vec2(420, 0), glm::vec2(1.0f),
-                           glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
-  }
-
-  // draw all sprites in the batch (note text is also a sprite)
-  this->spriteBatcher->Flush();
-
+int Game::unload() {
+  // the workers run code from this library, stop them before it is unloaded
+  AssetLoader::Shutdown();
+  // so do the commands it recorded
+  RenderThread::Drain();
   return 0;
 }
 
-int Game::unload() { return 0; }
-
 int Game::close() {
+  AssetLoader::Shutdown();
+  AssetArchive::Unmount();
   // clean up gl stuff
   return 0;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "renderer.hpp"
 #include "window.hpp"
@@ -17,22 +18,50 @@
 void emscripten_update();
 #endif
 
+// command line options
+struct AppOptions {
+  // render offscreen through EGL, no window, audio device or display needed
+  bool headless = false;
+  // quit after this many frames and report frame times, 0 runs until closed
+  int frames = 0;
+  // seconds the game advances every frame, 0 follows the wall clock
+  float fixed_dt = 0.0f;
+  // simulation ticks per second, 0 uses the game's default
+  int tick_rate = 0;
+  // write the profiler's zones as a chrome://tracing json on close
+  const char *trace_path = nullptr;
+  // append the render stats of every frame to a csv file
+  const char *stats_path = nullptr;
+  // issue GL from the main thread instead of a render thread
+  bool single_thread = false;
+};
+
+// --headless --frames N --fixed-dt [seconds] --tick-rate N --trace <file>
+// --stats <file> --single-thread, false on unknown arguments
+bool ParseAppOptions(int argc, char **argv, AppOptions *out);
+
 class App {
 public:
   App();
   ~App();
-  void run();
+  void run(const AppOptions &options = AppOptions());
   void update();
   void onClose();
   void poll_events();
 
 private:
+  void report_frame_times();
+
   bool is_running;
+  AppOptions options;
+  int frame = 0;
+  // cpu time of every frame in seconds, recorded when options.frames is set
+  std::vector<double> frame_times;
   std::unique_ptr<Window> window;
   std::unique_ptr<Renderer> renderer;
 
   SDL_AudioSpec want, have;
-  SDL_AudioDeviceID dev;
+  SDL_AudioDeviceID dev = 0;
 
   SharedData shared_data;
 
@@ -43,6 +72,4 @@ private:
 #endif
 };
 
-static float input_volume = 0.5f;
-
 void audio_callback(void *userdata, Uint8 *stream, int len);
\ No newline at end of file
@@ -3,9 +3,16 @@
 #include "app.hpp"
 
 #include <glm/glm.hpp>
+#include <mic-level.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <stdio.h>
+#include <stdlib.h>
 
+#include <profiler.hpp>
+#include <render-stats.hpp>
+#include <render-thread.hpp>
 #include <shared-data.hpp>
 
 #ifdef EMSCRIPTEN
@@ -20,6 +27,42 @@ void emscripten_update() { app_instance->update(); }
 #define SAMPLE_RATE 44100
 #define FRAMES_PER_BUFFER 512
 
+// step used by --fixed-dt without a value
+#define DEFAULT_FIXED_DT (1.0f / 60.0f)
+
+bool ParseAppOptions(int argc, char **argv, AppOptions *out) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--headless") == 0) {
+      out->headless = true;
+    } else if (strcmp(arg, "--frames") == 0 && i + 1 < argc) {
+      out->frames = atoi(argv[++i]);
+    } else if (strcmp(arg, "--fixed-dt") == 0) {
+      out->fixed_dt = DEFAULT_FIXED_DT;
+      // the step is optional
+      if (i + 1 < argc && argv[i + 1][0] != '-') {
+        out->fixed_dt = (float)atof(argv[++i]);
+      }
+    } else if (strcmp(arg, "--tick-rate") == 0 && i + 1 < argc) {
+      out->tick_rate = atoi(argv[++i]);
+    } else if (strcmp(arg, "--trace") == 0 && i + 1 < argc) {
+      out->trace_path = argv[++i];
+    } else if (strcmp(arg, "--stats") == 0 && i + 1 < argc) {
+      out->stats_path = argv[++i];
+    } else if (strcmp(arg, "--single-thread") == 0) {
+      out->single_thread = true;
+    } else {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                   "unknown argument %s, usage: %s [--headless] "
+                   "[--frames N] [--fixed-dt [seconds]] [--tick-rate N] "
+                   "[--trace file] [--stats file] [--single-thread]",
+                   arg, argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
 App::App() {
   this->is_running = true;
   // memset clear the shared data buffer
@@ -28,33 +71,68 @@ App::App() {
 
 App::~App() {}
 
-void App::run() {
+void App::run(const AppOptions &options) {
+  this->options = options;
 
   const auto initial_window_size = glm::vec2(800, 600);
-  this->window = std::make_unique<Window>(GAME_NAME, initial_window_size.x,
-                                          initial_window_size.y);
-  this->renderer = std::make_unique<Renderer>(this->window.get());
-
-  SDL_memset(&want, 0, sizeof(want)); /* or SDL_zero(want) */
-  want.freq = SAMPLE_RATE;
-  want.format = AUDIO_F32SYS;
-  want.channels = 1;
-  want.samples = FRAMES_PER_BUFFER;
-  want.callback = audio_callback;
-
-  SDL_AudioDeviceID dev = SDL_OpenAudioDevice(NULL, 1, &want, &have, 0);
-  if (dev == 0) {
-    SDL_Log("Failed to open audio: %s", SDL_GetError());
-    // @todo implement a retry mechanism
-    return;
-  }
+  if (options.headless) {
+    // no display and no microphone, music plays into the dummy driver
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS) < 0) {
+      SDL_Log("Failed to init SDL: %s", SDL_GetError());
+      return;
+    }
+    this->renderer = std::make_unique<Renderer>(initial_window_size.x,
+                                                initial_window_size.y);
+    if (!this->renderer->IsValid()) {
+      this->renderer.reset();
+      SDL_Quit();
+      return;
+    }
+  } else {
+    this->window = std::make_unique<Window>(GAME_NAME, initial_window_size.x,
+                                            initial_window_size.y);
+    this->renderer = std::make_unique<Renderer>(this->window.get());
 
-  // begin listining to audio
-  SDL_PauseAudioDevice(dev, 0);
+    SDL_memset(&want, 0, sizeof(want)); /* or SDL_zero(want) */
+    want.freq = SAMPLE_RATE;
+    want.format = AUDIO_F32SYS;
+    want.channels = 1;
+    want.samples = FRAMES_PER_BUFFER;
+    want.callback = audio_callback;
+
+    dev = SDL_OpenAudioDevice(NULL, 1, &want, &have, 0);
+    if (dev == 0) {
+      SDL_Log("Failed to open audio: %s", SDL_GetError());
+      // @todo implement a retry mechanism
+      return;
+    }
+    MicLevel::SetSampleRate(have.freq);
+
+    // begin listining to audio
+    SDL_PauseAudioDevice(dev, 0);
+  }
 
   SDL_StopTextInput(); // ensure this is off by default
 
-  this->shared_data.input_volume = &input_volume;
+  // from here on GL calls are recorded and run a frame behind
+  if (!options.single_thread) {
+    this->renderer->StartRenderThread();
+  }
+
+  this->shared_data.mic_level = MicLevel::Get();
+  this->shared_data.gl_get_proc_address = this->renderer->GetProcLoader();
+  this->shared_data.window_width = initial_window_size.x;
+  this->shared_data.window_height = initial_window_size.y;
+  this->shared_data.fixed_dt = options.fixed_dt;
+  this->shared_data.tick_rate = options.tick_rate;
+  this->shared_data.autoplay = options.headless;
+  this->shared_data.profiler = Profiler::Get();
+  this->shared_data.render_stats = RenderStats::Get();
+  this->shared_data.render_thread = RenderThread::Get();
+  if (options.stats_path != nullptr) {
+    RenderStats::OpenCsv(options.stats_path);
+  }
 
 #ifdef SHARED_GAME
   SDL_Log("Shared Lib: %s", GAME_LIBRARY_PATH);
@@ -68,20 +146,45 @@ void App::run() {
   app_instance = this;
   emscripten_set_main_loop(emscripten_update, 0, this->is_running);
 #else
+  if (options.frames > 0) {
+    this->frame_times.reserve(options.frames);
+  }
   while (this->is_running) {
+    const Uint64 start = SDL_GetPerformanceCounter();
     this->update();
+    if (options.frames > 0) {
+      this->frame_times.push_back((double)(SDL_GetPerformanceCounter() -
+                                           start) /
+                                  SDL_GetPerformanceFrequency());
+      if ((int)this->frame_times.size() >= options.frames) {
+        this->is_running = false;
+      }
+    }
   }
 #endif
 
   this->onClose();
+  this->report_frame_times();
 }
 
 void App::update() {
+  Profiler::BeginFrame();
   this->renderer->Clear();
   this->poll_events();
+  if (this->options.headless) {
+    // nobody is singing, sweep the player across the court instead
+    const float dt = this->options.fixed_dt > 0.0f ? this->options.fixed_dt
+                                                   : DEFAULT_FIXED_DT;
+    const float t = this->frame * dt;
+    const float level = 0.5f + 0.5f * std::sin(t * 1.3f);
+    MicLevel::PushFrame({level, level, dt});
+  }
+  MicLevel::Update();
+  this->frame++;
 #ifdef SHARED_GAME
   if (cr_plugin_changed(
           this->game_ctx)) { // full teardown needed on non windows
+    PROFILE_ZONE("HotReload");
     cr_plugin_close(this->game_ctx);
     cr_plugin_open(this->game_ctx, GAME_LIBRARY_PATH);
   }
@@ -92,6 +195,7 @@ void App::update() {
   this->game.update();
 #endif
   this->renderer->Present();
+  Profiler::EndFrame();
 }
 
 void App::onClose() {
@@ -102,14 +206,53 @@ void App::onClose() {
   this->game.unload();
   this->game.close();
 #endif
+  // the last frame may still be drawing
+  RenderThread::Drain();
+
+  if (this->dev != 0) {
+    SDL_CloseAudioDevice(dev);
+  }
+  if (this->options.trace_path != nullptr) {
+    Profiler::WriteChromeTrace(this->options.trace_path);
+  }
+  RenderStats::CloseCsv();
 
-  SDL_CloseAudioDevice(dev);
   // destroy the renderer this has to be done before the
   // window is destroyed
   this->renderer.reset();
+  if (this->options.headless) {
+    SDL_Quit();
+  }
+}
+
+void App::report_frame_times() {
+  if (this->frame_times.empty()) {
+    return;
+  }
+
+  std::vector<double> sorted = this->frame_times;
+  std::sort(sorted.begin(), sorted.end());
+  const auto percentile = [&](double p) {
+    return sorted[(size_t)(p * (sorted.size() - 1))] * 1000.0;
+  };
+  double total = 0.0;
+  for (const double time : sorted) {
+    total += time;
+  }
+
+  SDL_Log("%zu frames, cpu ms: mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f",
+          sorted.size(), total / sorted.size() * 1000.0, percentile(0.5),
+          percentile(0.95), percentile(0.99), sorted.back() * 1000.0);
+
+  const RenderCounters last = RenderStats::GetLastFrame();
+  SDL_Log("last frame: %u draw calls, %u program switches, %u texture binds, "
+          "%llu buffer bytes",
+          last.drawCalls, last.programSwitches, last.textureBinds,
+          (unsigned long long)last.bufferBytes);
 }
 
 void App::poll_events() {
+  PROFILE_ZONE("App::poll_events");
   SDL_Event event;
   while (SDL_PollEvent(&event)) {
     switch (event.type) {
@@ -139,15 +282,7 @@ void App::poll_events() {
 }
 
 void audio_callback(void *userdata, Uint8 *stream, int len) {
-  float *buffer = reinterpret_cast<float *>(stream);
-  float max = 0.0f;
-
-  for (int i = 0; i < len / sizeof(float); i++) {
-    float absValue = std::abs(buffer[i]);
-    if (absValue > max) {
-      max = absValue;
-    }
-  }
-
-  input_volume = max;
+  // only measure here, the frame loop smooths the levels
+  MicLevel::PushSamples(reinterpret_cast<const float *>(stream),
+                        len / sizeof(float));
 }
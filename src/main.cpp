@@ -1,7 +1,12 @@
 #include "app.hpp"
 
 int main(int argc, char **argv) {
+  AppOptions options;
+  if (!ParseAppOptions(argc, argv, &options)) {
+    return 1;
+  }
+
   App app;
-  app.run();
+  app.run(options);
   return 0;
 }
\ No newline at end of file
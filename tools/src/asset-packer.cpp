@@ -0,0 +1,187 @@
+// packs a directory of assets into a single archive read by AssetArchive
+//
+// usage: asset-packer [--zstd] [--prefix assets/] <directory> <output.pak>
+// entries are keyed by prefix + path relative to the directory, the same path
+// the game requests them with
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+#include "archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef ASSET_ARCHIVE_ZSTD
+#include <zstd.h>
+#endif
+
+// source files that never ship
+static const char *excludedExtensions[] = {".blend", ".blend1", ".pak"};
+
+// formats that are compressed already, zstd only wastes load time on them
+static const char *incompressibleExtensions[] = {".ogg", ".png", ".jpg",
+                                                 ".ktx2"};
+
+struct PackedFile {
+  std::string path;
+  uint64_t hash;
+  std::vector<uint8_t> data;
+  uint64_t originalSize;
+  ArchiveCompression compression;
+};
+
+static bool hasExtension(const std::filesystem::path &path,
+                         const char *const *extensions, size_t count) {
+  const std::string ext = path.extension().string();
+  for (size_t i = 0; i < count; i++) {
+    if (ext == extensions[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+  return (offset + ARCHIVE_ALIGNMENT - 1) & ~(uint64_t)(ARCHIVE_ALIGNMENT - 1);
+}
+
+int main(int argc, char *argv[]) {
+  bool compress = false;
+  std::string prefix = "assets/";
+  const char *input = nullptr;
+  const char *output = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--zstd") == 0) {
+      compress = true;
+    } else if (strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+      prefix = argv[++i];
+    } else if (input == nullptr) {
+      input = argv[i];
+    } else if (output == nullptr) {
+      output = argv[i];
+    }
+  }
+
+  if (input == nullptr || output == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "usage: asset-packer [--zstd] [--prefix assets/] <directory> "
+                 "<output.pak>");
+    return 1;
+  }
+
+#ifndef ASSET_ARCHIVE_ZSTD
+  if (compress) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                "Built without ASSET_ARCHIVE_ZSTD, packing uncompressed");
+    compress = false;
+  }
+#endif
+
+  std::vector<PackedFile> files;
+  std::error_code error;
+  for (const auto &item :
+       std::filesystem::recursive_directory_iterator(input, error)) {
+    if (!item.is_regular_file() ||
+        hasExtension(item.path(), excludedExtensions,
+                     SDL_arraysize(excludedExtensions))) {
+      continue;
+    }
+
+    PackedFile file;
+    file.path =
+        prefix +
+        std::filesystem::relative(item.path(), input).generic_string();
+    file.hash = HashArchivePath(file.path);
+    file.compression = ArchiveCompression::None;
+
+    std::ifstream stream(item.path(), std::ios::binary);
+    file.data.assign(std::istreambuf_iterator<char>(stream),
+                     std::istreambuf_iterator<char>());
+    file.originalSize = file.data.size();
+
+#ifdef ASSET_ARCHIVE_ZSTD
+    if (compress && !hasExtension(item.path(), incompressibleExtensions,
+                                  SDL_arraysize(incompressibleExtensions))) {
+      std::vector<uint8_t> compressed(ZSTD_compressBound(file.data.size()));
+      const size_t size =
+          ZSTD_compress(compressed.data(), compressed.size(), file.data.data(),
+                        file.data.size(), ZSTD_maxCLevel());
+      // only keep it when it saves at least an eighth, reads of uncompressed
+      // entries are zero copy
+      if (!ZSTD_isError(size) && size < file.data.size() * 7 / 8) {
+        compressed.resize(size);
+        file.data = std::move(compressed);
+        file.compression = ArchiveCompression::Zstd;
+      }
+    }
+#endif
+
+    files.push_back(std::move(file));
+  }
+
+  if (error) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not read %s: %s", input,
+                 error.message().c_str());
+    return 1;
+  }
+
+  // the TOC is binary searched by hash
+  std::sort(files.begin(), files.end(),
+            [](const PackedFile &a, const PackedFile &b) {
+              return a.hash < b.hash;
+            });
+
+  ArchiveHeader header = {};
+  header.magic = ARCHIVE_MAGIC;
+  header.version = ARCHIVE_VERSION;
+  header.entryCount = files.size();
+
+  std::vector<ArchiveEntry> entries(files.size());
+  std::string strings;
+  uint64_t offset =
+      sizeof(ArchiveHeader) + files.size() * sizeof(ArchiveEntry);
+  for (size_t i = 0; i < files.size(); i++) {
+    entries[i].hash = files[i].hash;
+    entries[i].pathOffset = offset + strings.size();
+    entries[i].pathLength = files[i].path.size();
+    entries[i].compression = files[i].compression;
+    entries[i].size = files[i].data.size();
+    entries[i].originalSize = files[i].originalSize;
+    strings += files[i].path;
+  }
+  offset += strings.size();
+  for (size_t i = 0; i < files.size(); i++) {
+    offset = alignOffset(offset);
+    entries[i].offset = offset;
+    offset += entries[i].size;
+  }
+  header.fileSize = offset;
+
+  std::vector<uint8_t> blob(header.fileSize, 0);
+  memcpy(blob.data(), &header, sizeof(header));
+  memcpy(blob.data() + sizeof(header), entries.data(),
+         entries.size() * sizeof(ArchiveEntry));
+  memcpy(blob.data() + sizeof(header) + entries.size() * sizeof(ArchiveEntry),
+         strings.data(), strings.size());
+  for (size_t i = 0; i < files.size(); i++) {
+    memcpy(blob.data() + entries[i].offset, files[i].data.data(),
+           files[i].data.size());
+  }
+
+  std::ofstream stream(output, std::ios::binary | std::ios::trunc);
+  stream.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+  if (!stream) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not write %s", output);
+    return 1;
+  }
+
+  SDL_Log("Packed %zu files into %s (%zu bytes)", files.size(), output,
+          blob.size());
+  return 0;
+}
@@ -0,0 +1,56 @@
+// offline model baker, converts glTF / glb files into the binary format read
+// by Model so the game never parses glTF at startup
+//
+// usage: model-baker [--float] <input.glb> <output.tbm>
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+#include "baked-model.hpp"
+#include "model.hpp"
+
+#include <cstring>
+#include <filesystem>
+
+int main(int argc, char *argv[]) {
+  VertexFormat format = VertexFormat::Packed;
+  const char *input = nullptr;
+  const char *output = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--float") == 0) {
+      format = VertexFormat::Float;
+    } else if (input == nullptr) {
+      input = argv[i];
+    } else if (output == nullptr) {
+      output = argv[i];
+    }
+  }
+
+  if (input == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "usage: model-baker [--float] <input.glb> <output.tbm>");
+    return 1;
+  }
+
+  const std::string outputPath =
+      output != nullptr ? output : GetBakedModelPath(input);
+
+  ModelData data;
+  if (!Model::ParseGLTF(input, &data)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not parse %s", input);
+    return 1;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(
+      std::filesystem::path(outputPath).parent_path(), error);
+
+  if (!WriteBakedModel(data, format, outputPath)) {
+    return 1;
+  }
+
+  SDL_Log("Baked %s -> %s (%zu meshes, %zu materials)", input,
+          outputPath.c_str(), data.meshes.size(), data.materials.size());
+  return 0;
+}
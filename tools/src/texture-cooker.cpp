@@ -0,0 +1,106 @@
+// offline texture cooker, converts images into KTX2 files holding an ETC2
+// compressed mip chain so the game uploads them without decoding
+//
+// usage: texture-cooker [--no-mips] <input.png> <output.ktx2>
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+#include "etc2.hpp"
+#include "ktx2.hpp"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// 2x2 box filter, odd edges repeat the last row / column
+static std::vector<uint8_t> downsample(const std::vector<uint8_t> &pixels,
+                                       int w, int h, int nw, int nh) {
+  std::vector<uint8_t> out((size_t)nw * nh * 4);
+  for (int y = 0; y < nh; y++) {
+    for (int x = 0; x < nw; x++) {
+      const int x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+      const int y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+      for (int c = 0; c < 4; c++) {
+        const int sum = pixels[((size_t)y0 * w + x0) * 4 + c] +
+                        pixels[((size_t)y0 * w + x1) * 4 + c] +
+                        pixels[((size_t)y1 * w + x0) * 4 + c] +
+                        pixels[((size_t)y1 * w + x1) * 4 + c];
+        out[((size_t)y * nw + x) * 4 + c] = (sum + 2) / 4;
+      }
+    }
+  }
+  return out;
+}
+
+int main(int argc, char *argv[]) {
+  bool mips = true;
+  const char *input = nullptr;
+  const char *output = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--no-mips") == 0) {
+      mips = false;
+    } else if (input == nullptr) {
+      input = argv[i];
+    } else if (output == nullptr) {
+      output = argv[i];
+    }
+  }
+
+  if (input == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "usage: texture-cooker [--no-mips] <input.png> <output.ktx2>");
+    return 1;
+  }
+
+  const std::string outputPath =
+      output != nullptr ? output : GetCookedTexturePath(input);
+
+  int w, h, channels;
+  unsigned char *loaded = stbi_load(input, &w, &h, &channels, STBI_rgb_alpha);
+  if (!loaded) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Could not load %s: %s", input,
+                 stbi_failure_reason());
+    return 1;
+  }
+  std::vector<uint8_t> pixels(loaded, loaded + (size_t)w * h * 4);
+  stbi_image_free(loaded);
+
+  ImageData image;
+  image.w = w;
+  image.h = h;
+  image.compressedFormat = GL_COMPRESSED_RGBA8_ETC2_EAC;
+
+  // encode level 0, then keep halving down to 1x1
+  int levelW = w, levelH = h;
+  while (true) {
+    const size_t size = GetETC2ImageSize(levelW, levelH);
+    const size_t offset = image.pixels.size();
+    image.pixels.resize(offset + size);
+    EncodeETC2Image(pixels.data(), levelW, levelH, &image.pixels[offset]);
+    image.levels.push_back({levelW, levelH, offset, size});
+
+    if (!mips || (levelW == 1 && levelH == 1)) {
+      break;
+    }
+    const int nextW = std::max(levelW / 2, 1);
+    const int nextH = std::max(levelH / 2, 1);
+    pixels = downsample(pixels, levelW, levelH, nextW, nextH);
+    levelW = nextW;
+    levelH = nextH;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(
+      std::filesystem::path(outputPath).parent_path(), error);
+
+  if (!WriteKTX2(image, outputPath)) {
+    return 1;
+  }
+
+  SDL_Log("Cooked %s -> %s (%ix%i, %zu levels, %zu bytes)", input,
+          outputPath.c_str(), w, h, image.levels.size(), image.pixels.size());
+  return 0;
+}